@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+
+// Binary protocol spoken by the generation daemon over its Unix domain socket.
+// Client and daemon always share a machine, so all fields are native endian.
+//
+// A client writes one Request per map. The daemon answers with one Response,
+// and on success attaches a shared memory file descriptor (SCM_RIGHTS) holding
+// byteSize bytes of tightly packed pixels, heights or palette indices for the client to mmap.
+namespace DaemonProtocol {
+    const std::uint32_t Magic = 0x4e454749; // "IGEN"
+    const std::uint16_t Version = 1;
+
+    // Largest accepted width or height
+    const std::uint32_t MaxDimension = 16384;
+
+    enum Output : std::uint16_t {
+        OutputColors = 0,   // RGBA8, 4 bytes per pixel
+        OutputHeights = 1,  // float32, 4 bytes per pixel
+        OutputIndices = 2   // Terrain palette index, 1 byte per pixel (TerrainSampler::getPalette())
+    };
+
+    enum Status : std::uint32_t {
+        StatusOk = 0,
+        StatusBadRequest = 1,
+        StatusFailed = 2
+    };
+
+    struct Request {
+        std::uint32_t magic;
+        std::uint16_t version;
+        std::uint16_t output;
+        std::uint32_t requestId;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::int32_t seed;
+        float scale;
+        std::int32_t octaves;
+        float persistence;
+        float seaLevel;
+        float beachSize;
+        float mountainLevel;
+        float snowLevel;
+    };
+
+    struct Response {
+        std::uint32_t magic;
+        std::uint32_t status;
+        std::uint32_t requestId;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint16_t output;
+        std::uint16_t reserved;
+        std::uint64_t byteSize;
+    };
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs export jobs on background threads so writing files never stalls the caller.
+// Jobs own copies of everything they write, several of them are encoded in parallel
+// and each one reports its progress and can be cancelled while queued or running.
+class ExportQueue {
+public:
+    enum class State {
+        Queued,
+        Running,
+        Done,
+        Failed,
+        Cancelled
+    };
+
+    // What a running job sees of the queue
+    class Context {
+    public:
+        // Jobs check this between steps and return early once it is set
+        bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+        // Fraction of the job done, in [0, 1]
+        void setProgress(float value) { progress.store(value, std::memory_order_relaxed); }
+        float getProgress() const { return progress.load(std::memory_order_relaxed); }
+
+    private:
+        friend class ExportQueue;
+        std::atomic<bool> cancelled{false};
+        std::atomic<float> progress{0.0f};
+    };
+
+    // Job body, throws on failure and simply returns when cancelled
+    typedef std::function<void(Context& context)> Task;
+
+    // Snapshot of a job for display
+    struct Status {
+        int id;
+        std::string label;
+        State state;
+        float progress;
+        std::string message;    // Error of a failed job
+    };
+
+    // A thread count of 0 leaves one hardware core to the caller
+    explicit ExportQueue(unsigned int threadCount = 0);
+
+    // Cancels every job and waits for the running ones to return
+    ~ExportQueue();
+
+    ExportQueue(const ExportQueue&) = delete;
+    ExportQueue& operator=(const ExportQueue&) = delete;
+
+    // Queue a job and return its id, jobs start in submission order
+    int submit(const std::string& label, Task task);
+
+    // Queued jobs are dropped, running ones are asked to stop
+    void cancel(int id);
+    void cancelAll();
+
+    // Every job not cleared yet, in submission order
+    std::vector<Status> getStatus() const;
+
+    // Forget jobs that are done, failed or cancelled
+    void clearFinished();
+
+    // Jobs queued or running
+    std::size_t getPendingCount() const;
+
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(threads.size()); }
+
+private:
+    struct Job {
+        int id;
+        std::string label;
+        Task task;
+        State state;
+        std::string message;
+        Context context;
+    };
+
+    void workerLoop();
+
+    std::vector<std::thread> threads;
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::shared_ptr<Job>> queued;
+    std::vector<std::shared_ptr<Job>> jobs;
+    int nextId;
+    bool stopping;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include "TerrainSampler.hpp"
+#include "WorkerPool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scatters trees, rocks and settlements over a classified map with Poisson-disk
+// sampling, so no two instances of a rule are closer than its spacing. The map is
+// split into tiles placed in four passes of non-adjacent tiles, which keeps the
+// parallel result identical to the serial one for a given seed.
+class FeaturePlacer {
+public:
+    enum class InstanceKind : std::uint8_t {
+        Tree,
+        Bush,
+        Rock,
+        Settlement
+    };
+
+    // Instances of one kind placed on one terrain class, spacing is in map pixels
+    struct Rule {
+        TerrainSampler::TerrainType terrain;
+        InstanceKind kind;
+        float spacing;
+    };
+
+    // 8 bytes per instance, positions are in 1/65536 of the map width and height
+    struct Instance {
+        std::uint16_t x;
+        std::uint16_t y;
+        InstanceKind kind;
+        TerrainSampler::TerrainType terrain;
+        // Random bits for picking a model variant or rotation
+        std::uint16_t variant;
+    };
+
+    // Starts out with rules suited to the application's 512 x 512 map
+    FeaturePlacer();
+
+    // Rules are placed independently of each other, spacing is clamped to at least one pixel
+    void setRules(const std::vector<Rule>& newRules);
+    const std::vector<Rule>& getRules() const { return rules; }
+
+    // Place instances on a width x height map of palette indices (stride in bytes), see
+    // TerrainSampler::generateIndices(). Tiles run on the pool when one is given.
+    std::vector<Instance> place(const std::uint8_t* indices, unsigned int width, unsigned int height,
+                                std::size_t stride, int seed, WorkerPool* pool = nullptr) const;
+
+    // Encode instances as a little-endian binary list with a small header
+    static std::vector<std::uint8_t> encode(const std::vector<Instance>& instances,
+                                            unsigned int width, unsigned int height, int seed);
+
+    // Encode and write to a file, throws on failure
+    static void write(const std::string& filename, const std::vector<Instance>& instances,
+                      unsigned int width, unsigned int height, int seed);
+
+private:
+    std::vector<Rule> rules;
+};
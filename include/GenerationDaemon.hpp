@@ -0,0 +1,96 @@
+#pragma once
+#include "DaemonProtocol.hpp"
+#include "WorkerPool.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Long-running generator listening on a Unix domain socket. Requests that arrive
+// together are batched onto one worker pool, results go back through shared memory.
+//
+// One thread polls the non-blocking sockets and only moves bytes, a second one
+// generates the batches, so a slow client or a large map never holds up reading
+// and accepting.
+class GenerationDaemon {
+public:
+    GenerationDaemon(const std::string& socketPath, unsigned int threadCount);
+    ~GenerationDaemon();
+
+    GenerationDaemon(const GenerationDaemon&) = delete;
+    GenerationDaemon& operator=(const GenerationDaemon&) = delete;
+
+    // Serve clients until stop() is called
+    void run();
+
+    // Ask run() to return, safe to call from a signal handler
+    void stop();
+
+private:
+    // Requests of one client read but not answered yet, reading pauses beyond this
+    static constexpr std::size_t MaxOutstanding = 64;
+
+    struct Response {
+        DaemonProtocol::Response response;
+        int memoryFd;       // Shared memory with the result, -1 without one
+        std::size_t sent;   // Bytes of the response already on the socket
+    };
+
+    struct Client {
+        int fd;
+        std::vector<unsigned char> input;   // Start of a request still being received
+        std::deque<Response> output;        // Answers in request order, waiting for the socket
+        std::size_t outstanding;
+    };
+
+    // Clients are named by a serial number, file descriptors get reused while a batch runs
+    struct PendingRequest {
+        std::uint64_t client;
+        DaemonProtocol::Request request;
+    };
+
+    struct Result {
+        std::uint64_t client;
+        Response response;
+    };
+
+    std::string socketPath;
+    int listenSocket;
+    int wakePipe[2];
+    std::atomic<bool> stopRequested;
+    std::map<std::uint64_t, Client> clients;
+    std::uint64_t nextClient;
+    WorkerPool pool;
+
+    // Shared between the poll thread and the batch thread
+    std::mutex mutex;
+    std::condition_variable batchCondition;
+    std::vector<PendingRequest> pending;
+    std::vector<Result> finished;
+    bool stopping;
+
+    void acceptClients();
+    void closeClient(std::uint64_t id);
+
+    // Receive what the socket has and queue every complete request, returns false
+    // once the client is gone or misbehaves
+    bool readClient(std::uint64_t id, Client& client, std::vector<PendingRequest>& requests);
+
+    // Send queued answers until the socket is full, returns false on errors
+    bool flushClient(Client& client);
+
+    // Hand finished results to their clients' output queues
+    void collectResults();
+
+    // Batch thread, takes everything pending whenever the previous batch is done
+    void batchLoop();
+
+    // Generate every request of a batch on the shared pool
+    std::vector<Result> processBatch(const std::vector<PendingRequest>& batch);
+};
@@ -1,18 +1,48 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include "ExportQueue.hpp"
+#include "MapGenerator.hpp"
 #include "NoiseGenerator.hpp"
+#include "TerrainSampler.hpp"
+#include "TerrainMesh.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
 
 class IslandGenerator {
 public:
     // Terrain types
-    enum class TerrainType {
-        DeepWater,
-        ShallowWater,
-        Beach,
-        Grass,
-        Forest,
-        Mountain,
-        Snow
+    using TerrainType = TerrainSampler::TerrainType;
+    
+    // How generate() stores its result
+    enum class OutputMode {
+        Color,      // RGBA pixels, optionally shaded
+        Indexed     // One palette index per pixel, the texture is expanded from the palette
+    };
+    
+    // Copy of the generated island and the settings behind it, taken on the UI thread
+    // so an export can be written on another one while the island keeps changing
+    struct Snapshot {
+        unsigned int width = 0;
+        unsigned int height = 0;
+        OutputMode outputMode = OutputMode::Color;
+        bool shading = false;
+        std::vector<std::uint8_t> pixels;   // RGBA, or palette indices in indexed mode
+        std::vector<std::uint8_t> normals;  // RGBA normal map while shading
+        TerrainSampler terrain;
+        TerrainSampler::Lighting lighting = TerrainSampler::Lighting::fromAngles(315.0f, 45.0f, 0.25f);
+        NoiseGenerator noiseGen;
+        float scale = 4.0f;
+        int octaves = 6;
+        float persistence = 0.5f;
+    };
+    
+    // Files an export writes next to the image
+    struct ExportOptions {
+        bool features = false;      // _features.bin
+        bool mesh = false;          // _mesh.glb, or _mesh.obj with meshObj
+        bool meshObj = false;
+        TerrainMesh::Options meshOptions;
     };
 
     IslandGenerator(unsigned int width, unsigned int height);
@@ -20,29 +50,120 @@ public:
     // Generate island using given noise parameters
     void generate(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence);
     
+    // Terrain and lighting that generateRegion() reads, copied so regions can be
+    // generated on other threads while the island keeps changing
+    struct RegionSettings {
+        TerrainSampler terrain;
+        bool shading = false;
+        TerrainSampler::Lighting lighting = TerrainSampler::Lighting::fromAngles(315.0f, 45.0f, 0.25f);
+    };
+    RegionSettings getRegionSettings() const;
+    
+    // Generate the square world region starting at (left, top) with the given extent as
+    // size x size RGBA pixels. Coordinates stay double up to the noise lattice, so deep
+    // zoom levels keep their detail. Safe to call from any thread.
+    static void generateRegion(const RegionSettings& settings, const NoiseGenerator& noiseGen,
+                               float scale, int octaves, float persistence,
+                               double left, double top, double extent, unsigned int size, std::uint8_t* pixels);
+    
     // Get the generated texture
     const sf::Texture& getTexture() const;
     
+    // Get the normal map generated alongside the shaded texture
+    const sf::Texture& getNormalTexture() const;
+    
+    // Copy the last generate() from the CPU side buffers, no GPU readback involved
+    Snapshot snapshot(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence) const;
+    
+    // Only the settings of a snapshot, with empty buffers for render() to fill
+    Snapshot snapshotSettings(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence) const;
+    
+    // Generate the pixels of a snapshot from its own settings, for exporting variants
+    // of the current island. Returns false when the context is cancelled first.
+    static bool render(Snapshot& snapshot, ExportQueue::Context& context);
+    
+    // Write the image of a snapshot, indexed in indexed mode, the normal map when it is
+    // shaded and the files of the options. Stops between files once cancelled, safe to
+    // call from any thread.
+    static void writeSnapshot(const Snapshot& snapshot, const std::string& filename,
+                              const ExportOptions& options, ExportQueue::Context& context);
+    
     // Export the generated island to a PNG file
     void exportToPNG(const std::string& filename) const;
     
+    // Export the palette indices as an 8-bit indexed PNG, only available in indexed mode
+    void exportIndexedPNG(const std::string& filename) const;
+    
+    // Export the normal map to a PNG file, only available while shading is enabled
+    void exportNormalMapToPNG(const std::string& filename) const;
+    
+    // Place trees, rocks and settlements on the island and write the binary instance list,
+    // the placement seed is the noise seed
+    void exportFeatures(const std::string& filename, const NoiseGenerator& noiseGen,
+                        float scale, int octaves, float persistence) const;
+    
+    // Build an adaptive 3D mesh from the heights and write it as binary glTF, or as OBJ
+    // when the filename ends in .obj. The grid has at least one step per map pixel.
+    void exportMesh(const std::string& filename, const NoiseGenerator& noiseGen,
+                    float scale, int octaves, float persistence, const TerrainMesh::Options& options) const;
+    
     // Set terrain parameters
     void setSeaLevel(float level);
     void setBeachSize(float size);
     void setMountainLevel(float level);
     void setSnowLevel(float level);
     
+    // Moisture and temperature fields for Whittaker biomes on the lowlands
+    void setClimate(const TerrainSampler::ClimateSettings& settings);
+    const TerrainSampler::ClimateSettings& getClimate() const { return terrain.getClimate(); }
+    
+    // Directional light shading, which also produces the normal map
+    void setShading(bool enabled);
+    void setLighting(float azimuth, float elevation, float relief);
+    bool isShadingEnabled() const { return shading; }
+    
+    // Keep every octave as a layer so changing anything but the seed or scale only
+    // recombines them, used for unshaded color and indexed output by generate() and
+    // for the zoomed out levels of TileCache. Enabled by default.
+    void setOctaveCache(bool enabled);
+    bool isOctaveCacheEnabled() const { return octaveCaching; }
+    
+    // Output mode, shading only applies to color output
+    void setOutputMode(OutputMode mode);
+    OutputMode getOutputMode() const { return outputMode; }
+    
+    // Palette indices of the last generate() in indexed mode, one byte per pixel,
+    // see TerrainSampler::getPalette() and TerrainSampler::getPaletteTerrainType()
+    const std::vector<std::uint8_t>& getTerrainIndices() const { return map.getIndices(); }
+    
 private:
     unsigned int width;
     unsigned int height;
     sf::RenderTexture renderTexture;
+    sf::Texture normalTexture;
+    
+    // Terrain parameters and height evaluation
+    TerrainSampler terrain;
+    
+    // Shading parameters
+    bool shading;
+    TerrainSampler::Lighting lighting;
+    
+    // Indexed output
+    OutputMode outputMode;
+    
+    // Octave layers of the current seed and scale
+    bool octaveCaching;
     
-    // Terrain parameters
-    float seaLevel;
-    float beachSize;
-    float mountainLevel;
-    float snowLevel;
+    // What the textures were made from, kept so exports don't read them back. Indexed
+    // mode keeps only the palette indices.
+    MapGenerator map;
     
-    // Helper function to get terrain color based on height
-    sf::Color getTerrainColor(float height) const;
+    // Shared by the member exports and the snapshot writers
+    static void writeFeatures(const std::string& filename, const TerrainSampler& terrain,
+                              const std::uint8_t* classes, unsigned int width, unsigned int height,
+                              const NoiseGenerator& noiseGen, float scale, int octaves, float persistence);
+    static void writeMesh(const std::string& filename, const TerrainSampler& terrain,
+                          unsigned int width, unsigned int height, const NoiseGenerator& noiseGen,
+                          float scale, int octaves, float persistence, const TerrainMesh::Options& options);
 }; 
\ No newline at end of file
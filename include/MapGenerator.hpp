@@ -0,0 +1,49 @@
+#pragma once
+#include "NoiseGenerator.hpp"
+#include "OctaveCache.hpp"
+#include "TerrainSampler.hpp"
+#include "WorkerPool.hpp"
+#include <cstdint>
+#include <vector>
+
+// Whole maps on the CPU the way the application shows them: palette indices, shaded
+// colors with their normal map or plain colors, through the octave cache where it
+// applies. Shared by IslandGenerator and the headless session replay, so both run the
+// same work for the same settings.
+class MapGenerator {
+public:
+    // How a map is generated, shading only applies to color output
+    struct Settings {
+        bool indexed = false;
+        bool shading = false;
+        TerrainSampler::Lighting lighting = TerrainSampler::Lighting::fromAngles(315.0f, 45.0f, 0.25f);
+        bool octaveCache = true;
+    };
+
+    // Fill the buffers of a width x height map. Indexed output keeps only the indices,
+    // color output the RGBA pixels and, while shading, the normal map. Buffers the output
+    // doesn't use are released, and so are the octave layers without the cache.
+    void generate(const TerrainSampler& terrain, const NoiseGenerator& noiseGen, float scale, int octaves,
+                  float persistence, unsigned int width, unsigned int height, const Settings& settings);
+
+    // RGBA pixels, four bytes per pixel
+    const std::vector<std::uint8_t>& getPixels() const { return pixels; }
+
+    // RGBA normal map of shaded output
+    const std::vector<std::uint8_t>& getNormals() const { return normals; }
+
+    // Palette indices of indexed output, one byte per pixel
+    const std::vector<std::uint8_t>& getIndices() const { return indices; }
+
+    // Drop the octave layers
+    void clearCache() { octaveCache.clear(); }
+
+private:
+    std::vector<std::uint8_t> pixels;
+    std::vector<std::uint8_t> normals;
+    std::vector<std::uint8_t> indices;
+
+    // Octave layers of the current seed and scale, combined on the pool
+    OctaveCache octaveCache;
+    WorkerPool pool;
+};
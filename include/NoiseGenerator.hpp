@@ -2,6 +2,39 @@
 
 class NoiseGenerator {
 public:
+    // Noise value together with its partial derivatives
+    struct Sample {
+        float value;
+        float dx;
+        float dy;
+    };
+
+    // Running fbm sum for callers that stop adding octaves once the remaining ones
+    // can't change their result. After all octaves getTotal() / getWeight() is fbm().
+    class OctaveSum {
+    public:
+        OctaveSum(const NoiseGenerator& noiseGen, float x, float y, float persistence);
+        
+        // Add the next octave
+        void addOctave();
+        
+        // Weighted sum and sum of the weights of the octaves added so far
+        float getTotal() const { return total; }
+        float getWeight() const { return weight; }
+        
+    private:
+        const NoiseGenerator& noiseGen;
+        float x, y;
+        float persistence;
+        float total;
+        float weight;
+        float frequency;
+        float amplitude;
+    };
+
+    // Upper bound of |noise()|, and so of |fbm()|
+    static constexpr float MaxNoise = 1.0f;
+
     NoiseGenerator();
     
     // Generate noise value at given coordinates
@@ -10,6 +43,18 @@ public:
     // Generate Fractal Brownian Motion noise
     float fbm(float x, float y, int octaves, float persistence) const;
     
+    // Same as noise() and fbm() but also return the analytic derivatives
+    Sample noiseWithDerivatives(float x, float y) const;
+    Sample fbmWithDerivatives(float x, float y, int octaves, float persistence) const;
+    
+    // Same functions at double precision coordinates, for deep zoom levels where
+    // neighbouring pixels are closer together than float can tell apart. Only the
+    // lattice cell is found in double, the position inside it stays float.
+    float noise(double x, double y) const;
+    float fbm(double x, double y, int octaves, float persistence) const;
+    Sample noiseWithDerivatives(double x, double y) const;
+    Sample fbmWithDerivatives(double x, double y, int octaves, float persistence) const;
+    
     // Set seed for noise generation
     void setSeed(int newSeed);
     
@@ -19,9 +64,15 @@ public:
 private:
     int seed;
     
+    // Noise and derivatives inside lattice cell (X, Y) masked to [0, 255], x and y in [0, 1)
+    float noiseInCell(int X, int Y, float x, float y) const;
+    Sample noiseWithDerivativesInCell(int X, int Y, float x, float y) const;
+    
     // Helper functions for noise generation
     float fade(float t) const;
+    float fadeDerivative(float t) const;
     float lerp(float a, float b, float t) const;
     float grad(int hash, float x, float y) const;
+    void gradVector(int hash, float& gx, float& gy) const;
     int hash(int x, int y) const;
 }; 
\ No newline at end of file
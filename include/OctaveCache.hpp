@@ -0,0 +1,81 @@
+#pragma once
+#include "NoiseGenerator.hpp"
+#include "TerrainSampler.hpp"
+#include "WorkerPool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Raw noise of every octave of a map, kept as float layers together with the island
+// mask. The octaves don't depend on the persistence, so changing it, the octave count
+// or the terrain levels only recombines the layers as a weighted sum, which comes out
+// exactly as generating the map directly. Layers are dropped when the seed, scale or
+// map size change.
+//
+// A new seed or scale is generated directly at first, the layers are built once a
+// second generation uses the same noise, as dragging any other slider does.
+class OctaveCache {
+public:
+    static constexpr std::size_t DefaultMemoryBudget = std::size_t(256) << 20;
+
+    explicit OctaveCache(std::size_t memoryBudget = DefaultMemoryBudget);
+
+    // Layers that don't fit the budget are dropped, octaves without a layer are
+    // evaluated directly
+    void setMemoryBudget(std::size_t bytes);
+    std::size_t getMemoryBudget() const { return memoryBudget; }
+
+    // Whole map of colors or palette indices through the cache, see
+    // TerrainSampler::generateColors() and generateIndices(). Rows run on the pool when given.
+    void generateColors(const TerrainSampler& terrain, const NoiseGenerator& noiseGen,
+                        float scale, int octaves, float persistence, unsigned int width, unsigned int height,
+                        std::uint8_t* pixels, std::size_t stride, WorkerPool* pool = nullptr);
+    void generateIndices(const TerrainSampler& terrain, const NoiseGenerator& noiseGen,
+                         float scale, int octaves, float persistence, unsigned int width, unsigned int height,
+                         std::uint8_t* indices, std::size_t stride, WorkerPool* pool = nullptr);
+
+    // Drop every layer
+    void clear();
+
+    int getCachedOctaves() const { return static_cast<int>(layers.size()); }
+    std::size_t getMemoryUsage() const;
+
+private:
+    // Everything the layers depend on
+    struct Key {
+        int seed = 0;
+        float scale = 0.0f;
+        unsigned int width = 0;
+        unsigned int height = 0;
+
+        bool operator==(const Key& other) const {
+            return seed == other.seed && scale == other.scale && width == other.width && height == other.height;
+        }
+    };
+
+    std::size_t memoryBudget;
+    Key cachedKey;
+    Key lastKey;
+    std::vector<float> masks;
+    std::vector<std::vector<float>> layers;
+
+    // Layers of the first octaves that fit the budget next to the masks
+    int layersWithinBudget(unsigned int width, unsigned int height) const;
+
+    // Returns false when the map should be generated directly instead
+    bool prepare(const TerrainSampler& terrain, const NoiseGenerator& noiseGen, float scale, int octaves,
+                 unsigned int width, unsigned int height, WorkerPool* pool);
+
+    // fbm values of a row segment from the layers and direct evaluation beyond them
+    void combine(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                 unsigned int width, unsigned int height, unsigned int left, unsigned int y,
+                 unsigned int columns, float* noise) const;
+
+    template <typename Task>
+    static void forEachBlock(unsigned int height, WorkerPool* pool, const Task& task);
+
+    // Combine the map in row segments and hand each one with its masks to convert
+    template <typename Convert>
+    void forEachSegment(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                        unsigned int width, unsigned int height, WorkerPool* pool, const Convert& convert) const;
+};
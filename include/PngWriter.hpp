@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal PNG encoder for 8-bit palette images, which sf::Image can't write, and for
+// RGBA images without SFML so exports can be encoded off the UI thread.
+// Compression is a single pass of LZ77 with fixed Huffman codes, tuned for
+// speed on images made of long runs such as terrain class maps.
+class PngWriter {
+public:
+    struct PaletteEntry {
+        std::uint8_t r, g, b;
+    };
+
+    // Encode width x height palette indices (stride in bytes) into PNG file bytes
+    static std::vector<std::uint8_t> encodeIndexed(unsigned int width, unsigned int height,
+                                                   const std::uint8_t* indices, std::size_t stride,
+                                                   const PaletteEntry* palette, std::size_t paletteSize);
+
+    // Encode and write to a file, throws on failure
+    static void writeIndexed(const std::string& filename, unsigned int width, unsigned int height,
+                             const std::uint8_t* indices, std::size_t stride,
+                             const PaletteEntry* palette, std::size_t paletteSize);
+
+    // Encode width x height RGBA pixels (stride in bytes) into PNG file bytes
+    static std::vector<std::uint8_t> encodeRGBA(unsigned int width, unsigned int height,
+                                                const std::uint8_t* pixels, std::size_t stride);
+
+    // Encode and write to a file, throws on failure
+    static void writeRGBA(const std::string& filename, unsigned int width, unsigned int height,
+                          const std::uint8_t* pixels, std::size_t stride);
+};
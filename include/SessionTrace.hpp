@@ -0,0 +1,71 @@
+#pragma once
+#include "TerrainSampler.hpp"
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Interactive sessions stored as text traces for headless replay. Every
+// regeneration is one line with the milliseconds since the session started and
+// the parameters that changed since the previous line, the first line has all of them.
+// The time a regeneration took runs until the map view showed all of its tiles.
+class SessionTrace {
+public:
+    // Everything a regeneration depends on, defaults match the application
+    struct Parameters {
+        int seed = 1;
+        float scale = 4.0f;
+        int octaves = 6;
+        float persistence = 0.5f;
+        float seaLevel = 0.500f;
+        float beachSize = 0.030f;
+        float mountainLevel = 0.610f;
+        float snowLevel = 0.700f;
+        bool shading = false;
+        float lightAzimuth = 315.0f;
+        float lightElevation = 45.0f;
+        float relief = 0.25f;
+        bool indexed = false;
+        bool octaveCache = true;
+        TerrainSampler::ClimateSettings climate;
+    };
+
+    struct Event {
+        // Milliseconds since the session started
+        double time;
+        // Parameters after applying the change
+        Parameters parameters;
+        // Time until the application showed the regeneration, negative when unknown
+        double recordedLatency;
+    };
+
+    // Writes a trace while the application runs
+    class Recorder {
+    public:
+        // Throws when the file can't be created
+        Recorder(const std::string& filename, unsigned int width, unsigned int height);
+
+        // Log a regeneration once it is shown, with the parameters it used and the
+        // milliseconds since it started, at which the line is timed. One replaced by the
+        // next regeneration before it was shown is logged without the time it took.
+        void record(const Parameters& parameters, double latency, bool shown = true);
+
+    private:
+        std::ofstream file;
+        std::chrono::steady_clock::time_point start;
+        Parameters previous;
+        bool first;
+    };
+
+    // Load a trace, throws on failure
+    static SessionTrace load(const std::string& filename);
+
+    unsigned int getWidth() const { return width; }
+    unsigned int getHeight() const { return height; }
+    const std::vector<Event>& getEvents() const { return events; }
+
+private:
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<Event> events;
+};
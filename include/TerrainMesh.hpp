@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Adaptive triangle mesh of a heightmap, built as a right-triangulated irregular
+// network. The error of every possible triangle, measured over all grid points it
+// covers, is computed in one bottom-up pass over the grid and carried up to the larger
+// triangles, so whatever error threshold is picked the mesh never has cracks between
+// triangles of different sizes.
+class TerrainMesh {
+public:
+    struct Options {
+        // World units per grid step and per unit of height
+        float cellSize = 1.0f;
+        float heightScale = 64.0f;
+        // Largest vertical distance between the mesh and any height of the grid, in world units
+        float maxError = 0.5f;
+        // Most triangles the mesh may have, 0 for no limit. The error bound is raised
+        // until the mesh fits.
+        std::size_t maxTriangles = 0;
+    };
+
+    // x runs along the map columns, z along the rows and y is up
+    struct Vertex {
+        float x, y, z;
+        float nx, ny, nz;
+    };
+
+    // Mesh of a gridSize x gridSize heightmap, gridSize must be a power of two plus one.
+    // Throws otherwise.
+    static TerrainMesh build(const float* heights, unsigned int gridSize, const Options& options);
+
+    // Smallest valid grid size with at least one grid step per pixel of a map
+    static unsigned int gridSizeFor(unsigned int width, unsigned int height);
+
+    const std::vector<Vertex>& getVertices() const { return vertices; }
+
+    // Three indices per triangle, counter-clockwise seen from above
+    const std::vector<std::uint32_t>& getIndices() const { return indices; }
+    std::size_t getTriangleCount() const { return indices.size() / 3; }
+
+    // Error bound the mesh was built with, in world units
+    float getMaxError() const { return maxError; }
+
+    // Binary glTF 2.0 with positions, normals and 32-bit indices in one buffer
+    std::vector<std::uint8_t> encodeGlb() const;
+
+    // Write a Wavefront OBJ when the filename ends in .obj and binary glTF otherwise,
+    // throws on failure
+    void write(const std::string& filename) const;
+
+private:
+    std::vector<Vertex> vertices;
+    std::vector<std::uint32_t> indices;
+    float maxError = 0.0f;
+
+    void writeObj(const std::string& filename) const;
+};
@@ -0,0 +1,254 @@
+#pragma once
+#include "NoiseGenerator.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Height and color evaluation of the island, free of any SFML or OpenGL
+// dependency so it can be used by headless front ends
+class TerrainSampler {
+public:
+    struct Color {
+        std::uint8_t r, g, b, a;
+    };
+
+    // Terrain types
+    enum class TerrainType : std::uint8_t {
+        DeepWater,
+        ShallowWater,
+        Beach,
+        Grass,
+        Forest,
+        Mountain,
+        Snow,
+        // Lowland biomes only assigned by the climate classification
+        Tundra,
+        Taiga,
+        Shrubland,
+        TemperateRainforest,
+        Desert,
+        Savanna,
+        TropicalRainforest
+    };
+
+    // Number of terrain types
+    static constexpr std::size_t TerrainTypeCount = 14;
+
+    // Palette indices, every color getTerrainColor() can return has exactly one entry.
+    // The grass band runs from GrassPaletteIndex to MountainPaletteIndex - 1, the
+    // climate biomes from Tundra on follow the snow entry in enum order.
+    static constexpr std::uint8_t DeepWaterPaletteIndex = 0;
+    static constexpr std::uint8_t ShallowWaterPaletteIndex = 1;
+    static constexpr std::uint8_t BeachPaletteIndex = 2;
+    static constexpr std::uint8_t GrassPaletteIndex = 3;
+    static constexpr std::uint8_t MountainPaletteIndex = 97;
+    static constexpr std::uint8_t SnowPaletteIndex = 98;
+    static constexpr std::uint8_t BiomePaletteIndex = 99;
+    static constexpr std::size_t PaletteSize = 106;
+
+    // Height together with its slope along normalized x and y
+    struct HeightSample {
+        float height;
+        float dx;
+        float dy;
+    };
+
+    // Directional light used for hillshading
+    struct Lighting {
+        // Unit vector pointing towards the light, y grows towards the bottom of the map
+        float x, y, z;
+        // Vertical exaggeration applied to slopes
+        float relief;
+        // Brightness of surfaces facing away from the light
+        float ambient;
+
+        // Azimuth is the compass direction the light comes from in degrees, 0 being
+        // the top of the map, elevation is the angle above the horizon in degrees
+        static Lighting fromAngles(float azimuth, float elevation, float relief);
+    };
+
+    // Moisture and temperature noise fields that split the lowlands into Whittaker
+    // biomes. Both fields use the height noise seed plus their own offset.
+    struct ClimateSettings {
+        bool enabled = false;
+        // Noise scale of both fields, below the height scale for broad climate zones
+        float scale = 1.5f;
+        int octaves = 4;
+        int moistureSeedOffset = 101;
+        int temperatureSeedOffset = 211;
+        // Temperature drop per unit of height above sea level
+        float lapseRate = 2.0f;
+    };
+
+    TerrainSampler();
+    
+    // Get the island height at normalized coordinates
+    float sampleHeight(const NoiseGenerator& noiseGen, float nx, float ny,
+                       float scale, int octaves, float persistence) const;
+    
+    // Same height as sampleHeight() together with its analytic derivatives
+    HeightSample sampleHeightWithDerivatives(const NoiseGenerator& noiseGen, float nx, float ny,
+                                             float scale, int octaves, float persistence) const;
+    
+    // Get terrain color based on height
+    Color getTerrainColor(float height) const;
+    
+    // Get the terrain class based on height
+    TerrainType getTerrainType(float height) const;
+    
+    // Get the palette index of the color getTerrainColor() returns for a height
+    std::uint8_t getPaletteIndex(float height) const;
+    
+    // Moisture and temperature in [0, 1] at normalized coordinates, the temperature
+    // drops with the height above sea level
+    float sampleMoisture(const NoiseGenerator& noiseGen, float nx, float ny) const;
+    float sampleTemperature(const NoiseGenerator& noiseGen, float nx, float ny, float height) const;
+    
+    // Palette index including the climate biomes, only the lowlands between beach and
+    // mountains look at moisture and temperature. Grass and forest keep the height gradient.
+    std::uint8_t getBiomePaletteIndex(float height, float moisture, float temperature) const;
+    
+    // Whittaker classification of a lowland climate
+    static TerrainType getWhittakerBiome(float moisture, float temperature);
+    
+    // Palette index of a pixel as generateIndices() computes it, octavesUsed receives
+    // the number of octaves evaluated when not null
+    std::uint8_t sampleBoundedPaletteIndex(const NoiseGenerator& noiseGen, float nx, float ny,
+                                           float scale, int octaves, float persistence, int* octavesUsed) const;
+    
+    // Palette built from getTerrainColor(), the colors don't depend on the terrain levels
+    static const std::array<Color, PaletteSize>& getPalette();
+    
+    // Terrain class of a palette index
+    static TerrainType getPaletteTerrainType(std::uint8_t index);
+    
+    // Color at normalized coordinates including the climate biomes when enabled,
+    // unshaded or lit by a directional light
+    Color sampleColor(const NoiseGenerator& noiseGen, float nx, float ny,
+                      float scale, int octaves, float persistence) const;
+    Color sampleShadedColor(const NoiseGenerator& noiseGen, float nx, float ny,
+                            float scale, int octaves, float persistence, const Lighting& lighting) const;
+    
+    // Same colors with the height noise sampled at double precision coordinates, for
+    // zoomed in regions. The island mask and climate fields are smooth enough for float.
+    Color sampleColor(const NoiseGenerator& noiseGen, double nx, double ny,
+                      float scale, int octaves, float persistence) const;
+    Color sampleShadedColor(const NoiseGenerator& noiseGen, double nx, double ny,
+                            float scale, int octaves, float persistence, const Lighting& lighting) const;
+    
+    // Get the terrain color lit by a directional light, water is left unshaded
+    Color getShadedColor(const HeightSample& sample, const Lighting& lighting) const;
+    
+    // Encode the surface normal as RGB in the OpenGL convention, green pointing to the top of the map
+    Color getNormalColor(const HeightSample& sample, const Lighting& lighting) const;
+    
+    // Island mask at normalized coordinates, land needs a mask above zero
+    float sampleMask(float nx, float ny) const;
+    
+    // Same as generateColors() and generateIndices() from precomputed fbm values and
+    // island masks, for callers that combine the octaves themselves. Both inputs have
+    // noiseStride floats per row.
+    void colorsFromNoise(const NoiseGenerator& noiseGen, const float* noise, const float* masks, std::size_t noiseStride,
+                         unsigned int width, unsigned int height,
+                         unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                         std::uint8_t* pixels, std::size_t stride) const;
+    void indicesFromNoise(const NoiseGenerator& noiseGen, const float* noise, const float* masks, std::size_t noiseStride,
+                          unsigned int width, unsigned int height,
+                          unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                          std::uint8_t* indices, std::size_t stride) const;
+    
+    // Fill a rectangle of a width x height map with heights, stride is in floats
+    void generateHeights(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                         unsigned int width, unsigned int height,
+                         unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                         float* heights, std::size_t stride) const;
+    
+    // The color, index and shaded variants evaluate the climate fields in the same
+    // loop as the height when the climate is enabled
+    
+    // Fill a rectangle of a width x height map with RGBA pixels, stride is in bytes
+    void generateColors(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                        unsigned int width, unsigned int height,
+                        unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                        std::uint8_t* pixels, std::size_t stride) const;
+    
+    // Fill a rectangle of a width x height map with palette indices, stride is in bytes
+    void generateIndices(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                         unsigned int width, unsigned int height,
+                         unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                         std::uint8_t* indices, std::size_t stride) const;
+    
+    // Fill a rectangle with hillshaded RGBA pixels and, unless normals is null, the
+    // matching normal map, both from a single evaluation per pixel
+    void generateShaded(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                        unsigned int width, unsigned int height,
+                        unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                        const Lighting& lighting,
+                        std::uint8_t* pixels, std::size_t stride,
+                        std::uint8_t* normals, std::size_t normalStride) const;
+    
+    // Set terrain parameters
+    void setSeaLevel(float level);
+    void setBeachSize(float size);
+    void setMountainLevel(float level);
+    void setSnowLevel(float level);
+    
+    // Bounded evaluation skips the noise where the island mask is zero and, for colors
+    // and indices, stops adding octaves once the remaining ones can't change the
+    // palette index. The output is the same as without it. Enabled by default.
+    void setBoundedEvaluation(bool enabled);
+    bool getBoundedEvaluation() const { return boundedEvaluation; }
+    
+    // Climate fields, disabled by default
+    void setClimate(const ClimateSettings& settings);
+    const ClimateSettings& getClimate() const { return climate; }
+    
+    // Get terrain parameters
+    float getSeaLevel() const { return seaLevel; }
+    float getBeachSize() const { return beachSize; }
+    float getMountainLevel() const { return mountainLevel; }
+    float getSnowLevel() const { return snowLevel; }
+    
+private:
+    // Terrain parameters
+    float seaLevel;
+    float beachSize;
+    float mountainLevel;
+    float snowLevel;
+    ClimateSettings climate;
+    bool boundedEvaluation;
+    
+    // Height from normalized noise and the island mask
+    float islandHeight(float noiseValue, float mask) const;
+    
+    // Height and slope from fbm with derivatives and the island mask with its slope
+    HeightSample islandHeight(const NoiseGenerator::Sample& noise, float scale,
+                              float mask, float maskDx, float maskDy) const;
+    
+    // Palette index of a pixel, with bounded evaluation only as many octaves as decide it.
+    // Weight is the sum of all octave amplitudes.
+    std::uint8_t evaluatePaletteIndex(const NoiseGenerator& noiseGen, const NoiseGenerator& moistureGen,
+                                      const NoiseGenerator& temperatureGen, float nx, float ny,
+                                      float scale, int octaves, float persistence, float weight,
+                                      int* octavesUsed) const;
+    
+    // Whether the climate fields matter at this height
+    bool isLowland(float height) const;
+    
+    // Palette index of a pixel, evaluating the climate fields only where they matter
+    std::uint8_t samplePaletteIndex(const NoiseGenerator& moistureGen, const NoiseGenerator& temperatureGen,
+                                    float nx, float ny, float height) const;
+    
+    // Apply the directional light to a land color
+    Color shade(Color color, const HeightSample& sample, const Lighting& lighting) const;
+    
+    // Climate field in [0, 1] from its own noise generator
+    float climateField(const NoiseGenerator& fieldGen, float nx, float ny) const;
+    
+    // Noise generators of the two climate fields for a height noise generator
+    NoiseGenerator moistureGenerator(const NoiseGenerator& noiseGen) const;
+    NoiseGenerator temperatureGenerator(const NoiseGenerator& noiseGen) const;
+    
+    // Combined falloff of all island centers, with its slope when requested
+    float islandMask(float nx, float ny, float* slopeX, float* slopeY) const;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "NoiseGenerator.hpp"
+#include "IslandGenerator.hpp"
+#include "OctaveCache.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Caches fixed-size tiles of the island at power-of-two zoom levels so the map
+// view only ever generates the visible region at screen resolution. Tiles are
+// generated on worker threads, coarser cached tiles fill in until they arrive.
+class TileCache {
+public:
+    // Pixel size of a single tile
+    static constexpr unsigned int TileSize = 256;
+
+    // Deepest zoom level, level 0 is one tile covering the whole world
+    static constexpr int MaxLevel = 14;
+
+    // Upper bound for the octave count once extra detail is added while zooming
+    static constexpr int MaxOctaves = 16;
+
+    // Levels below this one cover the world at the default zoom. Their tiles are built
+    // together as one map through an octave cache, so dragging a slider only recombines
+    // the octave layers there (unshaded output with the cache enabled).
+    static constexpr int CachedLevels = 2;
+
+    // A tile (or part of a coarser one) to draw over a rectangle of the world
+    struct DrawItem {
+        const sf::Texture* texture;
+        float u0, v0, u1, v1;
+        double left, top, right, bottom;
+    };
+
+    // A thread count of 0 leaves one hardware core to the caller
+    explicit TileCache(std::size_t maxTiles = 384, unsigned int threadCount = 0);
+    ~TileCache();
+
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // Mark every cached tile as outdated, needed whenever a generation parameter changes.
+    // Outdated tiles are only drawn until the new whole-world tile is ready.
+    void clear();
+
+    // Collect the tiles covering the visible world rectangle, falling back to coarser
+    // cached tiles where the sharp ones are missing. Missing tiles are requested from
+    // the workers, closest to the view center first, and finished ones are uploaded
+    // until the time budget is used up.
+    std::vector<DrawItem> update(const IslandGenerator& islandGen, const NoiseGenerator& noiseGen,
+                                 float scale, int octaves, float persistence,
+                                 double viewLeft, double viewTop, double viewRight, double viewBottom,
+                                 double pixelsPerUnit, sf::Time budget);
+
+    // Zoom level and octave count used by the last update
+    int getLevel() const { return currentLevel; }
+    int getOctaves() const { return currentOctaves; }
+
+    // Number of visible tiles still waiting to be generated
+    int getPendingTiles() const { return pendingTiles; }
+
+private:
+    struct TileKey {
+        int level;
+        int x;
+        int y;
+
+        bool operator<(const TileKey& other) const {
+            if (level != other.level) return level < other.level;
+            if (y != other.y) return y < other.y;
+            return x < other.x;
+        }
+    };
+
+    struct Tile {
+        sf::Texture texture;
+        unsigned int lastUsed;
+        unsigned int generation;
+    };
+
+    // Everything a worker needs to generate tiles of one generation
+    struct Settings {
+        IslandGenerator::RegionSettings region;
+        NoiseGenerator noiseGen;
+        float scale;
+        int octaves;
+        float persistence;
+        bool octaveCache;
+        unsigned int generation;
+    };
+
+    struct Finished {
+        TileKey key;
+        unsigned int generation;
+        std::vector<std::uint8_t> pixels;
+    };
+
+    std::map<TileKey, std::unique_ptr<Tile>> tiles;
+    std::size_t maxTiles;
+    unsigned int frame;
+    unsigned int generation;
+    int currentLevel;
+    int currentOctaves;
+    int pendingTiles;
+    bool staleTiles;
+
+    // Shared with the workers, requests are replaced every update in priority order
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::shared_ptr<const Settings> settings;
+    std::vector<TileKey> requests;
+    std::set<TileKey> inFlight;
+    std::vector<Finished> finished;
+    bool stopping;
+
+    // Octave layers of the cached levels, each level is built by one worker at a time
+    OctaveCache levelCaches[CachedLevels];
+    std::mutex levelMutexes[CachedLevels];
+
+    // Octave count for a level, adding one octave per doubling of resolution
+    static int octavesForLevel(int level, int octaves);
+
+    void workerLoop();
+
+    // Pixels of a single tile, evaluated directly
+    static void generateTile(const Settings& current, Finished& done);
+
+    // Every tile of a cached level, combined from the octave layers of that level
+    void generateLevel(const Settings& current, int level, std::vector<Finished>& done);
+
+    // Turn finished pixels of the current generation into textures
+    void upload(sf::Time budget);
+
+    // Find the tile itself or the closest cached ancestor, preferring current tiles
+    const Tile* findCovering(const TileKey& key, TileKey& found);
+    const Tile* findCovering(const TileKey& key, TileKey& found, bool current);
+
+    bool isCached(const TileKey& key) const;
+
+    // Evict least recently used tiles above the cache limit
+    void evict();
+};
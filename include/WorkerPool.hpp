@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that split indexed tasks between them and the
+// calling thread. Dispatching work does not allocate, tasks must not throw.
+class WorkerPool {
+public:
+    // A thread count of 0 uses one thread per hardware core
+    explicit WorkerPool(unsigned int threadCount = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Number of threads working on a call, including the caller
+    unsigned int getThreadCount() const;
+
+    // Run task(i) for every i in [0, count) and return once all of them finished
+    template <typename Task>
+    void parallelFor(int count, const Task& task) {
+        run(count, &invokeTask<Task>, &task);
+    }
+
+private:
+    typedef void (*TaskFunction)(const void* context, int index);
+
+    template <typename Task>
+    static void invokeTask(const void* context, int index) {
+        (*static_cast<const Task*>(context))(index);
+    }
+
+    void run(int count, TaskFunction function, const void* context);
+    void workerLoop();
+    void drain();
+
+    std::vector<std::thread> threads;
+    std::mutex runMutex;
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+
+    TaskFunction taskFunction;
+    const void* taskContext;
+    int taskCount;
+    std::atomic<int> nextTask;
+    unsigned int busyWorkers;
+    unsigned int generation;
+    bool stopping;
+};
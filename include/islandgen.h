@@ -0,0 +1,178 @@
+#ifndef ISLANDGEN_H
+#define ISLANDGEN_H
+
+/*
+ * Plain C interface of the island generator (libislandgen).
+ *
+ * The library does not depend on SFML or OpenGL. All output goes into buffers
+ * owned by the caller, and the generate calls never allocate. A generator
+ * handle must not be used from two threads at once, but separate handles can
+ * be used from as many threads as needed.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(ISLANDGEN_BUILD)
+#    define ISLANDGEN_API __declspec(dllexport)
+#  else
+#    define ISLANDGEN_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define ISLANDGEN_API __attribute__((visibility("default")))
+#else
+#  define ISLANDGEN_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever the ABI changes incompatibly */
+#define ISLANDGEN_API_VERSION 1
+
+typedef struct islandgen_generator islandgen_generator;
+
+typedef enum islandgen_status {
+    ISLANDGEN_OK = 0,
+    ISLANDGEN_INVALID_ARGUMENT = 1,
+    ISLANDGEN_OUT_OF_MEMORY = 2,
+    ISLANDGEN_INTERNAL_ERROR = 3
+} islandgen_status;
+
+/* Terrain classes, in the same order as the generator's TerrainType */
+typedef enum islandgen_terrain_type {
+    ISLANDGEN_TERRAIN_DEEP_WATER = 0,
+    ISLANDGEN_TERRAIN_SHALLOW_WATER = 1,
+    ISLANDGEN_TERRAIN_BEACH = 2,
+    ISLANDGEN_TERRAIN_GRASS = 3,
+    ISLANDGEN_TERRAIN_FOREST = 4,
+    ISLANDGEN_TERRAIN_MOUNTAIN = 5,
+    ISLANDGEN_TERRAIN_SNOW = 6,
+    /* Only produced while the climate is enabled */
+    ISLANDGEN_TERRAIN_TUNDRA = 7,
+    ISLANDGEN_TERRAIN_TAIGA = 8,
+    ISLANDGEN_TERRAIN_SHRUBLAND = 9,
+    ISLANDGEN_TERRAIN_TEMPERATE_RAINFOREST = 10,
+    ISLANDGEN_TERRAIN_DESERT = 11,
+    ISLANDGEN_TERRAIN_SAVANNA = 12,
+    ISLANDGEN_TERRAIN_TROPICAL_RAINFOREST = 13
+} islandgen_terrain_type;
+
+/* Largest number of palette entries islandgen_get_palette can return */
+#define ISLANDGEN_MAX_PALETTE_SIZE 256
+
+typedef struct islandgen_params {
+    /* Noise parameters */
+    int32_t seed;
+    float scale;
+    int32_t octaves;
+    float persistence;      /* Greater than 0 */
+
+    /* Terrain parameters */
+    float sea_level;
+    float beach_size;
+    float mountain_level;
+    float snow_level;
+} islandgen_params;
+
+/*
+ * Moisture and temperature noise fields that split the lowlands into Whittaker
+ * biomes. They are evaluated in the same pass as the heights, and only where
+ * the height falls between beach and mountains.
+ */
+typedef struct islandgen_climate {
+    int32_t enabled;
+    /* Noise scale and octaves of both fields */
+    float scale;
+    int32_t octaves;
+    /* Added to the seed for the moisture and temperature noise */
+    int32_t moisture_seed_offset;
+    int32_t temperature_seed_offset;
+    /* Temperature drop per unit of height above sea level */
+    float lapse_rate;
+} islandgen_climate;
+
+/* Version the library was built with, compare against ISLANDGEN_API_VERSION */
+ISLANDGEN_API unsigned int islandgen_api_version(void);
+
+/* Human readable description of a status code */
+ISLANDGEN_API const char* islandgen_status_string(islandgen_status status);
+
+/* Fill params with the defaults used by the application */
+ISLANDGEN_API void islandgen_default_params(islandgen_params* params);
+
+/* Create a generator, params may be NULL for the defaults */
+ISLANDGEN_API islandgen_status islandgen_create(const islandgen_params* params, islandgen_generator** generator);
+
+/* Destroy a generator, NULL is ignored */
+ISLANDGEN_API void islandgen_destroy(islandgen_generator* generator);
+
+/* Replace the generation parameters */
+ISLANDGEN_API islandgen_status islandgen_set_params(islandgen_generator* generator, const islandgen_params* params);
+
+/* Fill climate with the defaults, the climate starts out disabled */
+ISLANDGEN_API void islandgen_default_climate(islandgen_climate* climate);
+
+/* Replace the climate settings, which affect the rgba and indices output */
+ISLANDGEN_API islandgen_status islandgen_set_climate(islandgen_generator* generator, const islandgen_climate* climate);
+
+/* Threads used by the generate calls, 0 uses every core, the default is 1 */
+ISLANDGEN_API islandgen_status islandgen_set_thread_count(islandgen_generator* generator, unsigned int threads);
+
+/*
+ * Generate a full width x height map. Heights are floats, colors are RGBA8.
+ * The stride is the distance between rows in bytes and must hold a full row.
+ */
+ISLANDGEN_API islandgen_status islandgen_generate_heights(islandgen_generator* generator,
+                                                          uint32_t width, uint32_t height,
+                                                          float* heights, size_t stride);
+ISLANDGEN_API islandgen_status islandgen_generate_rgba(islandgen_generator* generator,
+                                                       uint32_t width, uint32_t height,
+                                                       uint8_t* pixels, size_t stride);
+
+/*
+ * Generate only the rectangle at (left, top) of size columns x rows out of a
+ * width x height map. The first output element is the rectangle's top left pixel.
+ */
+ISLANDGEN_API islandgen_status islandgen_generate_heights_rect(islandgen_generator* generator,
+                                                               uint32_t width, uint32_t height,
+                                                               uint32_t left, uint32_t top,
+                                                               uint32_t columns, uint32_t rows,
+                                                               float* heights, size_t stride);
+ISLANDGEN_API islandgen_status islandgen_generate_rgba_rect(islandgen_generator* generator,
+                                                            uint32_t width, uint32_t height,
+                                                            uint32_t left, uint32_t top,
+                                                            uint32_t columns, uint32_t rows,
+                                                            uint8_t* pixels, size_t stride);
+
+/*
+ * Generate one palette index per pixel instead of RGBA, a quarter of the memory.
+ * Look the indices up with islandgen_get_palette or islandgen_palette_terrain_type.
+ * The stride is in bytes.
+ */
+ISLANDGEN_API islandgen_status islandgen_generate_indices(islandgen_generator* generator,
+                                                          uint32_t width, uint32_t height,
+                                                          uint8_t* indices, size_t stride);
+ISLANDGEN_API islandgen_status islandgen_generate_indices_rect(islandgen_generator* generator,
+                                                               uint32_t width, uint32_t height,
+                                                               uint32_t left, uint32_t top,
+                                                               uint32_t columns, uint32_t rows,
+                                                               uint8_t* indices, size_t stride);
+
+/*
+ * Copy the palette as RGBA8 into colors, which holds capacity entries (4 bytes each).
+ * count receives the palette size, pass colors as NULL to only query it.
+ * The colors don't depend on the parameters.
+ */
+ISLANDGEN_API islandgen_status islandgen_get_palette(uint8_t* colors, size_t capacity, size_t* count);
+
+/* Terrain class of a palette index */
+ISLANDGEN_API islandgen_terrain_type islandgen_palette_terrain_type(uint8_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ISLANDGEN_H */
@@ -0,0 +1,133 @@
+#include "ExportQueue.hpp"
+#include <algorithm>
+#include <exception>
+
+ExportQueue::ExportQueue(unsigned int threadCount)
+    : nextId(1)
+    , stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ExportQueue::workerLoop, this);
+    }
+}
+
+ExportQueue::~ExportQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cancelAll();
+    condition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+int ExportQueue::submit(const std::string& label, Task task) {
+    auto job = std::make_shared<Job>();
+    job->label = label;
+    job->task = std::move(task);
+    job->state = State::Queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job->id = nextId++;
+        jobs.push_back(job);
+        queued.push_back(job);
+    }
+    condition.notify_one();
+    return job->id;
+}
+
+void ExportQueue::cancel(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& job : jobs) {
+        if (job->id != id) {
+            continue;
+        }
+        job->context.cancelled.store(true, std::memory_order_relaxed);
+        if (job->state == State::Queued) {
+            job->state = State::Cancelled;
+            job->task = nullptr;
+            queued.erase(std::find(queued.begin(), queued.end(), job));
+        }
+        return;
+    }
+}
+
+void ExportQueue::cancelAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& job : jobs) {
+        job->context.cancelled.store(true, std::memory_order_relaxed);
+        if (job->state == State::Queued) {
+            job->state = State::Cancelled;
+            job->task = nullptr;
+        }
+    }
+    queued.clear();
+}
+
+std::vector<ExportQueue::Status> ExportQueue::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Status> status;
+    status.reserve(jobs.size());
+    for (const auto& job : jobs) {
+        float progress = job->state == State::Done ? 1.0f : job->context.progress.load(std::memory_order_relaxed);
+        status.push_back(Status{job->id, job->label, job->state, progress, job->message});
+    }
+    return status;
+}
+
+void ExportQueue::clearFinished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const std::shared_ptr<Job>& job) {
+        return job->state != State::Queued && job->state != State::Running;
+    }), jobs.end());
+}
+
+std::size_t ExportQueue::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<std::size_t>(std::count_if(jobs.begin(), jobs.end(), [](const std::shared_ptr<Job>& job) {
+        return job->state == State::Queued || job->state == State::Running;
+    }));
+}
+
+void ExportQueue::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        condition.wait(lock, [this] { return stopping || !queued.empty(); });
+        if (queued.empty()) {
+            return;
+        }
+
+        std::shared_ptr<Job> job = queued.front();
+        queued.pop_front();
+        job->state = State::Running;
+        Task task = std::move(job->task);
+        job->task = nullptr;
+        lock.unlock();
+
+        // The task and the buffers it owns are released before the job is reported finished
+        State state = State::Done;
+        std::string message;
+        try {
+            task(job->context);
+        } catch (const std::exception& e) {
+            state = State::Failed;
+            message = e.what();
+        } catch (...) {
+            state = State::Failed;
+            message = "Unknown error";
+        }
+        task = nullptr;
+        if (state == State::Done && job->context.isCancelled()) {
+            state = State::Cancelled;
+        }
+
+        lock.lock();
+        job->state = state;
+        job->message = message;
+    }
+}
@@ -0,0 +1,414 @@
+#include "FeaturePlacer.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    // Candidates tried around an active point before it is retired (Bridson's k)
+    const int CandidatesPerPoint = 30;
+
+    // Preferred tile edge in pixels, tiles never get narrower than two grid cells
+    const float TilePixels = 64.0f;
+
+    static_assert(TerrainSampler::TerrainTypeCount <= 16, "Presence masks hold one bit per terrain type");
+
+    // Edge of the blocks that record which terrain classes they contain
+    const unsigned int PresenceBlock = 16;
+
+    const char FileMagic[4] = { 'I', 'S', 'L', 'F' };
+    const std::uint32_t FileVersion = 1;
+
+    struct Point {
+        float x;
+        float y;
+    };
+
+    // Small counter-based generator, the same sequence on every platform
+    class Random {
+    public:
+        explicit Random(std::uint64_t seed) : state(seed) {}
+
+        std::uint64_t next() {
+            std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform in [0, 1)
+        float uniform() {
+            return static_cast<float>(next() >> 40) * (1.0f / 16777216.0f);
+        }
+
+    private:
+        std::uint64_t state;
+    };
+
+    std::uint64_t tileSeed(int seed, std::size_t rule, int tileX, int tileY) {
+        Random random(static_cast<std::uint64_t>(static_cast<std::uint32_t>(seed)) << 32
+                      ^ static_cast<std::uint64_t>(rule) << 48
+                      ^ static_cast<std::uint64_t>(static_cast<std::uint32_t>(tileY)) << 16
+                      ^ static_cast<std::uint64_t>(static_cast<std::uint32_t>(tileX)));
+        return random.next();
+    }
+
+    // Background grid with cells small enough to hold at most one point
+    struct Grid {
+        float cellSize;
+        int columns;
+        int rows;
+        std::vector<Point> cells;
+
+        bool isEmpty(int x, int y) const {
+            return cells[static_cast<std::size_t>(y) * columns + x].x < 0.0f;
+        }
+    };
+
+    // Everything a tile needs while placing one rule
+    struct Layer {
+        const std::uint8_t* indices;
+        std::size_t stride;
+        unsigned int width;
+        unsigned int height;
+        const std::array<TerrainSampler::TerrainType, 256>* terrainTypes;
+        TerrainSampler::TerrainType terrain;
+        FeaturePlacer::InstanceKind kind;
+        float spacing;
+        Grid* grid;
+        int tileCells;
+        // Bit per terrain class for every PresenceBlock x PresenceBlock block
+        const std::vector<std::uint16_t>* presence;
+        unsigned int presenceColumns;
+    };
+
+    class TilePlacer {
+    public:
+        TilePlacer(const Layer& layer, int tileX, int tileY, std::uint64_t seed, std::vector<FeaturePlacer::Instance>& out)
+            : layer(layer)
+            , grid(*layer.grid)
+            , random(seed)
+            , out(out)
+        {
+            firstColumn = tileX * layer.tileCells;
+            firstRow = tileY * layer.tileCells;
+            lastColumn = std::min(firstColumn + layer.tileCells, grid.columns);
+            lastRow = std::min(firstRow + layer.tileCells, grid.rows);
+            left = firstColumn * grid.cellSize;
+            top = firstRow * grid.cellSize;
+            right = std::min(lastColumn * grid.cellSize, static_cast<float>(layer.width));
+            bottom = std::min(lastRow * grid.cellSize, static_cast<float>(layer.height));
+        }
+
+        void run() {
+            if (!mayContainTerrain(left, top, right, bottom)) {
+                return;
+            }
+
+            // Every empty cell gets one chance to seed a new Bridson front, which
+            // reaches patches of terrain that aren't connected to each other
+            for (int row = firstRow; row < lastRow; ++row) {
+                for (int column = firstColumn; column < lastColumn; ++column) {
+                    if (!grid.isEmpty(column, row)
+                        || !mayContainTerrain(column * grid.cellSize, row * grid.cellSize,
+                                              (column + 1) * grid.cellSize, (row + 1) * grid.cellSize)) {
+                        continue;
+                    }
+                    Point candidate{ (column + random.uniform()) * grid.cellSize,
+                                     (row + random.uniform()) * grid.cellSize };
+                    if (accept(candidate)) {
+                        insert(candidate);
+                        grow();
+                    }
+                }
+            }
+        }
+
+    private:
+        const Layer& layer;
+        Grid& grid;
+        Random random;
+        std::vector<FeaturePlacer::Instance>& out;
+        std::vector<Point> active;
+        int firstColumn, firstRow, lastColumn, lastRow;
+        float left, top, right, bottom;
+
+        // Cheap test that skips areas without the terrain, mostly open sea
+        bool mayContainTerrain(float x0, float y0, float x1, float y1) const {
+            unsigned int left = std::min(static_cast<unsigned int>(x0), layer.width - 1) / PresenceBlock;
+            unsigned int top = std::min(static_cast<unsigned int>(y0), layer.height - 1) / PresenceBlock;
+            unsigned int right = std::min(static_cast<unsigned int>(x1), layer.width - 1) / PresenceBlock;
+            unsigned int bottom = std::min(static_cast<unsigned int>(y1), layer.height - 1) / PresenceBlock;
+            std::uint16_t bit = static_cast<std::uint16_t>(1u << static_cast<unsigned int>(layer.terrain));
+            const std::vector<std::uint16_t>& presence = *layer.presence;
+            for (unsigned int y = top; y <= bottom; ++y) {
+                for (unsigned int x = left; x <= right; ++x) {
+                    if (presence[y * layer.presenceColumns + x] & bit) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // Clamped so rounding at the tile edge can't reach into a neighbour's cells
+        void cellOf(const Point& point, int& column, int& row) const {
+            column = std::min(std::max(static_cast<int>(point.x / grid.cellSize), firstColumn), lastColumn - 1);
+            row = std::min(std::max(static_cast<int>(point.y / grid.cellSize), firstRow), lastRow - 1);
+        }
+
+        void grow() {
+            const float spacing = layer.spacing;
+            while (!active.empty()) {
+                std::size_t index = static_cast<std::size_t>(random.next() % active.size());
+                Point origin = active[index];
+
+                bool placed = false;
+                for (int attempt = 0; attempt < CandidatesPerPoint; ++attempt) {
+                    // Uniform over the annulus between one and two spacings
+                    float angle = random.uniform() * 6.2831853f;
+                    float distance = spacing * std::sqrt(1.0f + 3.0f * random.uniform());
+                    Point candidate{ origin.x + distance * std::cos(angle),
+                                     origin.y + distance * std::sin(angle) };
+                    if (accept(candidate)) {
+                        insert(candidate);
+                        placed = true;
+                        break;
+                    }
+                }
+
+                if (!placed) {
+                    active[index] = active.back();
+                    active.pop_back();
+                }
+            }
+        }
+
+        bool accept(const Point& candidate) const {
+            // Candidates stay inside the tile so it only ever writes its own cells,
+            // the neighbouring tile fills the gap along the border in its own pass
+            if (candidate.x < left || candidate.x >= right || candidate.y < top || candidate.y >= bottom) {
+                return false;
+            }
+
+            std::size_t pixel = static_cast<std::size_t>(candidate.y) * layer.stride + static_cast<std::size_t>(candidate.x);
+            if ((*layer.terrainTypes)[layer.indices[pixel]] != layer.terrain) {
+                return false;
+            }
+
+            int column, row;
+            cellOf(candidate, column, row);
+            if (!grid.isEmpty(column, row)) {
+                return false;
+            }
+
+            // Neighbours within one spacing are at most two cells away
+            const float minDistance2 = layer.spacing * layer.spacing;
+            int x0 = std::max(column - 2, 0);
+            int x1 = std::min(column + 2, grid.columns - 1);
+            int y0 = std::max(row - 2, 0);
+            int y1 = std::min(row + 2, grid.rows - 1);
+            for (int y = y0; y <= y1; ++y) {
+                const Point* cell = &grid.cells[static_cast<std::size_t>(y) * grid.columns];
+                for (int x = x0; x <= x1; ++x) {
+                    if (cell[x].x < 0.0f) {
+                        continue;
+                    }
+                    float dx = cell[x].x - candidate.x;
+                    float dy = cell[x].y - candidate.y;
+                    if (dx * dx + dy * dy < minDistance2) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        void insert(const Point& point) {
+            int column, row;
+            cellOf(point, column, row);
+            grid.cells[static_cast<std::size_t>(row) * grid.columns + column] = point;
+            active.push_back(point);
+
+            FeaturePlacer::Instance instance;
+            instance.x = static_cast<std::uint16_t>(std::min(point.x / layer.width * 65536.0f, 65535.0f));
+            instance.y = static_cast<std::uint16_t>(std::min(point.y / layer.height * 65536.0f, 65535.0f));
+            instance.kind = layer.kind;
+            instance.terrain = layer.terrain;
+            instance.variant = static_cast<std::uint16_t>(random.next() >> 48);
+            out.push_back(instance);
+        }
+    };
+
+    void putLittleEndian16(std::vector<std::uint8_t>& out, std::uint16_t value) {
+        out.push_back(static_cast<std::uint8_t>(value));
+        out.push_back(static_cast<std::uint8_t>(value >> 8));
+    }
+
+    void putLittleEndian32(std::vector<std::uint8_t>& out, std::uint32_t value) {
+        putLittleEndian16(out, static_cast<std::uint16_t>(value));
+        putLittleEndian16(out, static_cast<std::uint16_t>(value >> 16));
+    }
+}
+
+FeaturePlacer::FeaturePlacer() {
+    using TerrainType = TerrainSampler::TerrainType;
+    rules = {
+        { TerrainType::Forest, InstanceKind::Tree, 4.0f },
+        { TerrainType::Grass, InstanceKind::Tree, 14.0f },
+        { TerrainType::Grass, InstanceKind::Bush, 8.0f },
+        { TerrainType::Grass, InstanceKind::Settlement, 48.0f },
+        { TerrainType::Beach, InstanceKind::Rock, 20.0f },
+        { TerrainType::Mountain, InstanceKind::Rock, 8.0f },
+        { TerrainType::Snow, InstanceKind::Rock, 16.0f },
+        { TerrainType::Tundra, InstanceKind::Rock, 18.0f },
+        { TerrainType::Taiga, InstanceKind::Tree, 5.0f },
+        { TerrainType::Shrubland, InstanceKind::Bush, 6.0f },
+        { TerrainType::TemperateRainforest, InstanceKind::Tree, 3.0f },
+        { TerrainType::Desert, InstanceKind::Rock, 24.0f },
+        { TerrainType::Savanna, InstanceKind::Tree, 18.0f },
+        { TerrainType::Savanna, InstanceKind::Bush, 10.0f },
+        { TerrainType::TropicalRainforest, InstanceKind::Tree, 3.0f }
+    };
+}
+
+void FeaturePlacer::setRules(const std::vector<Rule>& newRules) {
+    rules = newRules;
+}
+
+std::vector<FeaturePlacer::Instance> FeaturePlacer::place(const std::uint8_t* indices, unsigned int width, unsigned int height,
+                                                          std::size_t stride, int seed, WorkerPool* pool) const {
+    std::vector<Instance> instances;
+    if (!indices || width == 0 || height == 0) {
+        return instances;
+    }
+
+    // Terrain class of every possible index, looked up once per candidate
+    std::array<TerrainSampler::TerrainType, 256> terrainTypes;
+    for (int i = 0; i < 256; ++i) {
+        terrainTypes[i] = TerrainSampler::getPaletteTerrainType(static_cast<std::uint8_t>(i));
+    }
+
+    // Terrain classes present in each block, one bit per TerrainType, so empty sea is skipped by every rule
+    unsigned int presenceColumns = (width + PresenceBlock - 1) / PresenceBlock;
+    unsigned int presenceRows = (height + PresenceBlock - 1) / PresenceBlock;
+    std::vector<std::uint16_t> presence(static_cast<std::size_t>(presenceColumns) * presenceRows, 0);
+    auto scanBlocks = [&](int blockRow) {
+        unsigned int y0 = static_cast<unsigned int>(blockRow) * PresenceBlock;
+        unsigned int y1 = std::min(y0 + PresenceBlock, height);
+        std::uint16_t* blocks = &presence[static_cast<std::size_t>(blockRow) * presenceColumns];
+        for (unsigned int y = y0; y < y1; ++y) {
+            const std::uint8_t* row = indices + static_cast<std::size_t>(y) * stride;
+            for (unsigned int x = 0; x < width; ++x) {
+                blocks[x / PresenceBlock] |= static_cast<std::uint16_t>(1u << static_cast<unsigned int>(terrainTypes[row[x]]));
+            }
+        }
+    };
+    if (pool) {
+        pool->parallelFor(static_cast<int>(presenceRows), scanBlocks);
+    } else {
+        for (int blockRow = 0; blockRow < static_cast<int>(presenceRows); ++blockRow) {
+            scanBlocks(blockRow);
+        }
+    }
+
+    Grid grid;
+    std::vector<std::vector<Instance>> tileInstances;
+    std::vector<int> phaseTiles;
+
+    for (std::size_t ruleIndex = 0; ruleIndex < rules.size(); ++ruleIndex) {
+        const Rule& rule = rules[ruleIndex];
+
+        Layer layer;
+        layer.indices = indices;
+        layer.stride = stride;
+        layer.width = width;
+        layer.height = height;
+        layer.terrainTypes = &terrainTypes;
+        layer.terrain = rule.terrain;
+        layer.kind = rule.kind;
+        layer.spacing = std::max(rule.spacing, 1.0f);
+        layer.grid = &grid;
+        layer.presence = &presence;
+        layer.presenceColumns = presenceColumns;
+
+        grid.cellSize = layer.spacing / std::sqrt(2.0f);
+        grid.columns = static_cast<int>(std::ceil(width / grid.cellSize));
+        grid.rows = static_cast<int>(std::ceil(height / grid.cellSize));
+        grid.cells.assign(static_cast<std::size_t>(grid.columns) * grid.rows, Point{ -1.0f, -1.0f });
+
+        // A tile reads up to two cells past its edges, so tiles of the same pass
+        // never see each other as long as the tile between them is at least that wide
+        layer.tileCells = std::max(2, static_cast<int>(std::ceil(TilePixels / grid.cellSize)));
+        int tilesX = (grid.columns + layer.tileCells - 1) / layer.tileCells;
+        int tilesY = (grid.rows + layer.tileCells - 1) / layer.tileCells;
+
+        tileInstances.assign(static_cast<std::size_t>(tilesX) * tilesY, std::vector<Instance>());
+
+        for (int phase = 0; phase < 4; ++phase) {
+            phaseTiles.clear();
+            for (int tileY = phase / 2; tileY < tilesY; tileY += 2) {
+                for (int tileX = phase % 2; tileX < tilesX; tileX += 2) {
+                    phaseTiles.push_back(tileY * tilesX + tileX);
+                }
+            }
+
+            auto task = [&](int i) {
+                int tile = phaseTiles[i];
+                int tileX = tile % tilesX;
+                int tileY = tile / tilesX;
+                TilePlacer placer(layer, tileX, tileY, tileSeed(seed, ruleIndex, tileX, tileY), tileInstances[tile]);
+                placer.run();
+            };
+
+            if (pool) {
+                pool->parallelFor(static_cast<int>(phaseTiles.size()), task);
+            } else {
+                for (int i = 0; i < static_cast<int>(phaseTiles.size()); ++i) {
+                    task(i);
+                }
+            }
+        }
+
+        // Concatenated in tile order, independent of which thread placed what
+        for (const auto& tile : tileInstances) {
+            instances.insert(instances.end(), tile.begin(), tile.end());
+        }
+    }
+
+    return instances;
+}
+
+std::vector<std::uint8_t> FeaturePlacer::encode(const std::vector<Instance>& instances,
+                                                unsigned int width, unsigned int height, int seed) {
+    std::vector<std::uint8_t> out;
+    out.reserve(24 + instances.size() * 8);
+
+    for (char c : FileMagic) {
+        out.push_back(static_cast<std::uint8_t>(c));
+    }
+    putLittleEndian32(out, FileVersion);
+    putLittleEndian32(out, width);
+    putLittleEndian32(out, height);
+    putLittleEndian32(out, static_cast<std::uint32_t>(seed));
+    putLittleEndian32(out, static_cast<std::uint32_t>(instances.size()));
+
+    for (const Instance& instance : instances) {
+        putLittleEndian16(out, instance.x);
+        putLittleEndian16(out, instance.y);
+        out.push_back(static_cast<std::uint8_t>(instance.kind));
+        out.push_back(static_cast<std::uint8_t>(instance.terrain));
+        putLittleEndian16(out, instance.variant);
+    }
+    return out;
+}
+
+void FeaturePlacer::write(const std::string& filename, const std::vector<Instance>& instances,
+                          unsigned int width, unsigned int height, int seed) {
+    std::vector<std::uint8_t> bytes = encode(instances, width, height, seed);
+    std::ofstream file(filename, std::ios::binary);
+    if (!file || !file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()))) {
+        throw std::runtime_error("Failed to write instance list: " + filename);
+    }
+}
@@ -0,0 +1,497 @@
+#include "GenerationDaemon.hpp"
+#include "NoiseGenerator.hpp"
+#include "TerrainSampler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // Rows handed to a worker at once, small enough to balance uneven batches
+    const unsigned int RowsPerBlock = 32;
+
+    // Anonymous shared memory the client can map once it receives the descriptor
+    int createSharedMemory(std::size_t size) {
+#ifdef __linux__
+        int fd = memfd_create("islandgen", MFD_CLOEXEC);
+#else
+        static std::atomic<unsigned int> counter(0);
+        std::string name = "/islandgen-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            shm_unlink(name.c_str());
+        }
+#endif
+        if (fd < 0) {
+            return -1;
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    void setNonBlocking(int fd) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    // Send the rest of a response, the descriptor goes along with its first byte.
+    // Returns the bytes sent, 0 when the socket is full and -1 on errors.
+    ssize_t sendResponse(int client, const DaemonProtocol::Response& response, std::size_t offset, int memoryFd) {
+        iovec payload;
+        payload.iov_base = reinterpret_cast<char*>(const_cast<DaemonProtocol::Response*>(&response)) + offset;
+        payload.iov_len = sizeof(response) - offset;
+
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = &payload;
+        message.msg_iovlen = 1;
+
+        // The result travels as a file descriptor, never through the socket itself
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        if (memoryFd >= 0 && offset == 0) {
+            std::memset(control, 0, sizeof(control));
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(header), &memoryFd, sizeof(int));
+        }
+
+        for (;;) {
+            ssize_t sent = sendmsg(client, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent >= 0) {
+                return sent;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+    }
+
+    bool isValid(const DaemonProtocol::Request& request) {
+        return request.magic == DaemonProtocol::Magic
+            && request.version == DaemonProtocol::Version
+            && (request.output == DaemonProtocol::OutputColors || request.output == DaemonProtocol::OutputHeights
+                || request.output == DaemonProtocol::OutputIndices)
+            && request.width > 0 && request.width <= DaemonProtocol::MaxDimension
+            && request.height > 0 && request.height <= DaemonProtocol::MaxDimension
+            && request.octaves >= 1 && request.octaves <= 16
+            && std::isfinite(request.scale) && request.scale > 0.0f
+            && std::isfinite(request.persistence) && request.persistence > 0.0f
+            && std::isfinite(request.seaLevel) && std::isfinite(request.beachSize)
+            && std::isfinite(request.mountainLevel) && std::isfinite(request.snowLevel);
+    }
+}
+
+GenerationDaemon::GenerationDaemon(const std::string& socketPath, unsigned int threadCount)
+    : socketPath(socketPath)
+    , listenSocket(-1)
+    , wakePipe{-1, -1}
+    , stopRequested(false)
+    , nextClient(1)
+    , pool(threadCount)
+    , stopping(false)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + socketPath);
+    }
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    if (pipe(wakePipe) != 0) {
+        throw std::runtime_error("Failed to create wake pipe");
+    }
+    setNonBlocking(wakePipe[0]);
+    setNonBlocking(wakePipe[1]);
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0) {
+        throw std::runtime_error("Failed to create socket");
+    }
+    setNonBlocking(listenSocket);
+
+    // A previous daemon may have left its socket file behind
+    unlink(socketPath.c_str());
+    if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(listenSocket);
+        throw std::runtime_error("Failed to bind socket: " + socketPath + " (" + std::strerror(errno) + ")");
+    }
+    chmod(socketPath.c_str(), 0600);
+
+    if (listen(listenSocket, SOMAXCONN) != 0) {
+        close(listenSocket);
+        unlink(socketPath.c_str());
+        throw std::runtime_error("Failed to listen on socket: " + socketPath);
+    }
+}
+
+GenerationDaemon::~GenerationDaemon() {
+    for (auto& entry : clients) {
+        for (const Response& response : entry.second.output) {
+            if (response.memoryFd >= 0) {
+                close(response.memoryFd);
+            }
+        }
+        close(entry.second.fd);
+    }
+    for (const Result& result : finished) {
+        if (result.response.memoryFd >= 0) {
+            close(result.response.memoryFd);
+        }
+    }
+    if (listenSocket >= 0) {
+        close(listenSocket);
+        unlink(socketPath.c_str());
+    }
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+}
+
+void GenerationDaemon::run() {
+    std::thread batchThread(&GenerationDaemon::batchLoop, this);
+
+    std::vector<pollfd> fds;
+    std::vector<std::uint64_t> polled;
+    std::vector<PendingRequest> requests;
+
+    while (!stopRequested.load()) {
+        fds.clear();
+        polled.clear();
+        fds.push_back(pollfd{wakePipe[0], POLLIN, 0});
+        fds.push_back(pollfd{listenSocket, POLLIN, 0});
+        for (const auto& entry : clients) {
+            const Client& client = entry.second;
+            short events = client.outstanding < MaxOutstanding ? POLLIN : 0;
+            if (!client.output.empty()) {
+                events |= POLLOUT;
+            }
+            fds.push_back(pollfd{client.fd, events, 0});
+            polled.push_back(entry.first);
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char bytes[64];
+            while (read(wakePipe[0], bytes, sizeof(bytes)) > 0) {
+            }
+            collectResults();
+        }
+        if (fds[1].revents & POLLIN) {
+            acceptClients();
+        }
+
+        requests.clear();
+        for (std::size_t i = 2; i < fds.size(); ++i) {
+            auto it = clients.find(polled[i - 2]);
+            short revents = fds[i].revents;
+            if (revents == 0 || it == clients.end()) {
+                continue;
+            }
+            bool open = (revents & (POLLERR | POLLNVAL)) == 0;
+            if (open && (revents & POLLIN)) {
+                open = readClient(it->first, it->second, requests);
+            } else if (open && (revents & POLLHUP)) {
+                open = false;
+            }
+            if (open && (revents & POLLOUT)) {
+                open = flushClient(it->second);
+            }
+            if (!open) {
+                closeClient(it->first);
+            }
+        }
+
+        // Everything read in this round joins the next batch
+        if (!requests.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.insert(pending.end(), requests.begin(), requests.end());
+            batchCondition.notify_one();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    batchCondition.notify_one();
+    batchThread.join();
+}
+
+void GenerationDaemon::stop() {
+    stopRequested.store(true);
+    char byte = 1;
+    ssize_t written = write(wakePipe[1], &byte, 1);
+    (void)written;
+}
+
+void GenerationDaemon::acceptClients() {
+    for (;;) {
+        int fd = accept(listenSocket, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        setNonBlocking(fd);
+
+        Client client;
+        client.fd = fd;
+        client.outstanding = 0;
+        clients.emplace(nextClient++, std::move(client));
+    }
+}
+
+void GenerationDaemon::closeClient(std::uint64_t id) {
+    auto it = clients.find(id);
+    if (it == clients.end()) {
+        return;
+    }
+    for (const Response& response : it->second.output) {
+        if (response.memoryFd >= 0) {
+            close(response.memoryFd);
+        }
+    }
+    close(it->second.fd);
+    clients.erase(it);
+}
+
+bool GenerationDaemon::readClient(std::uint64_t id, Client& client, std::vector<PendingRequest>& requests) {
+    // Only as many bytes as the free request slots hold, the rest waits in the socket
+    if (client.outstanding >= MaxOutstanding) {
+        return true;
+    }
+    unsigned char buffer[4096];
+    std::size_t room = (MaxOutstanding - client.outstanding) * sizeof(DaemonProtocol::Request) - client.input.size();
+    ssize_t received;
+    do {
+        received = recv(client.fd, buffer, std::min(room, sizeof(buffer)), 0);
+    } while (received < 0 && errno == EINTR);
+    if (received == 0) {
+        return false;
+    }
+    if (received < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    client.input.insert(client.input.end(), buffer, buffer + received);
+
+    // Every complete request is taken, so pipelined requests share a batch
+    std::size_t offset = 0;
+    while (client.input.size() - offset >= sizeof(DaemonProtocol::Request)) {
+        PendingRequest request;
+        request.client = id;
+        std::memcpy(&request.request, client.input.data() + offset, sizeof(request.request));
+        requests.push_back(request);
+        offset += sizeof(DaemonProtocol::Request);
+        ++client.outstanding;
+    }
+    client.input.erase(client.input.begin(), client.input.begin() + static_cast<std::ptrdiff_t>(offset));
+    return true;
+}
+
+bool GenerationDaemon::flushClient(Client& client) {
+    while (!client.output.empty()) {
+        Response& response = client.output.front();
+        ssize_t sent = sendResponse(client.fd, response.response, response.sent, response.memoryFd);
+        if (sent < 0) {
+            return false;
+        }
+        if (sent == 0) {
+            return true;
+        }
+
+        // The descriptor is duplicated into the client with the first byte
+        if (response.memoryFd >= 0) {
+            close(response.memoryFd);
+            response.memoryFd = -1;
+        }
+        response.sent += static_cast<std::size_t>(sent);
+        if (response.sent < sizeof(response.response)) {
+            return true;
+        }
+        client.output.pop_front();
+        --client.outstanding;
+    }
+    return true;
+}
+
+void GenerationDaemon::collectResults() {
+    std::vector<Result> results;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.swap(finished);
+    }
+
+    for (const Result& result : results) {
+        auto it = clients.find(result.client);
+        if (it == clients.end()) {
+            // The client left while its map was generated
+            if (result.response.memoryFd >= 0) {
+                close(result.response.memoryFd);
+            }
+            continue;
+        }
+        it->second.output.push_back(result.response);
+    }
+
+    // Most answers fit the socket right away, the rest wait for POLLOUT
+    for (auto it = clients.begin(); it != clients.end();) {
+        std::uint64_t id = it->first;
+        bool open = flushClient(it->second);
+        ++it;
+        if (!open) {
+            closeClient(id);
+        }
+    }
+}
+
+void GenerationDaemon::batchLoop() {
+    std::vector<PendingRequest> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        batchCondition.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (stopping) {
+            return;
+        }
+        batch.clear();
+        batch.swap(pending);
+        lock.unlock();
+
+        std::vector<Result> results = processBatch(batch);
+
+        lock.lock();
+        finished.insert(finished.end(), results.begin(), results.end());
+        char byte = 0;
+        ssize_t written = write(wakePipe[1], &byte, 1);
+        (void)written;
+    }
+}
+
+std::vector<GenerationDaemon::Result> GenerationDaemon::processBatch(const std::vector<PendingRequest>& batch) {
+    struct Job {
+        NoiseGenerator noiseGen;
+        TerrainSampler terrain;
+        DaemonProtocol::Response response;
+        unsigned char* memory;
+        int memoryFd;
+    };
+
+    struct Block {
+        std::size_t job;
+        unsigned int row;
+    };
+
+    std::vector<Job> jobs(batch.size());
+    std::vector<Block> blocks;
+
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        const DaemonProtocol::Request& request = batch[i].request;
+        Job& job = jobs[i];
+        job.memory = nullptr;
+        job.memoryFd = -1;
+
+        std::memset(&job.response, 0, sizeof(job.response));
+        job.response.magic = DaemonProtocol::Magic;
+        job.response.requestId = request.requestId;
+
+        if (!isValid(request)) {
+            job.response.status = DaemonProtocol::StatusBadRequest;
+            continue;
+        }
+
+        job.response.width = request.width;
+        job.response.height = request.height;
+        job.response.output = request.output;
+        std::uint64_t pixelSize = request.output == DaemonProtocol::OutputIndices ? 1 : 4;
+        job.response.byteSize = static_cast<std::uint64_t>(request.width) * request.height * pixelSize;
+
+        job.noiseGen.setSeed(request.seed);
+        job.terrain.setSeaLevel(request.seaLevel);
+        job.terrain.setBeachSize(request.beachSize);
+        job.terrain.setMountainLevel(request.mountainLevel);
+        job.terrain.setSnowLevel(request.snowLevel);
+
+        job.memoryFd = createSharedMemory(job.response.byteSize);
+        if (job.memoryFd >= 0) {
+            void* memory = mmap(nullptr, job.response.byteSize, PROT_READ | PROT_WRITE, MAP_SHARED, job.memoryFd, 0);
+            if (memory != MAP_FAILED) {
+                job.memory = static_cast<unsigned char*>(memory);
+            }
+        }
+        if (!job.memory) {
+            if (job.memoryFd >= 0) {
+                close(job.memoryFd);
+                job.memoryFd = -1;
+            }
+            job.response.status = DaemonProtocol::StatusFailed;
+            job.response.byteSize = 0;
+            continue;
+        }
+
+        job.response.status = DaemonProtocol::StatusOk;
+        for (unsigned int row = 0; row < request.height; row += RowsPerBlock) {
+            blocks.push_back(Block{i, row});
+        }
+    }
+
+    // Row blocks of all requests in the batch share the pool
+    pool.parallelFor(static_cast<int>(blocks.size()), [&](int index) {
+        const Block& block = blocks[index];
+        const DaemonProtocol::Request& request = batch[block.job].request;
+        const Job& job = jobs[block.job];
+        unsigned int rows = std::min(RowsPerBlock, request.height - block.row);
+        std::size_t rowBytes = static_cast<std::size_t>(request.width) * 4;
+
+        if (request.output == DaemonProtocol::OutputIndices) {
+            job.terrain.generateIndices(job.noiseGen, request.scale, request.octaves, request.persistence,
+                                        request.width, request.height, 0, block.row, request.width, rows,
+                                        job.memory + static_cast<std::size_t>(block.row) * request.width, request.width);
+        } else if (request.output == DaemonProtocol::OutputHeights) {
+            float* heights = reinterpret_cast<float*>(job.memory) + static_cast<std::size_t>(block.row) * request.width;
+            job.terrain.generateHeights(job.noiseGen, request.scale, request.octaves, request.persistence,
+                                        request.width, request.height, 0, block.row, request.width, rows,
+                                        heights, request.width);
+        } else {
+            job.terrain.generateColors(job.noiseGen, request.scale, request.octaves, request.persistence,
+                                       request.width, request.height, 0, block.row, request.width, rows,
+                                       job.memory + block.row * rowBytes, rowBytes);
+        }
+    });
+
+    std::vector<Result> results;
+    results.reserve(batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        Job& job = jobs[i];
+        if (job.memory) {
+            munmap(job.memory, job.response.byteSize);
+        }
+        Result result;
+        result.client = batch[i].client;
+        result.response.response = job.response;
+        result.response.memoryFd = job.memoryFd;
+        result.response.sent = 0;
+        results.push_back(result);
+    }
+    return results;
+}
@@ -1,13 +1,53 @@
 #include "IslandGenerator.hpp"
-#include <cmath>
+#include "FeaturePlacer.hpp"
+#include "PngWriter.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace {
+    // Rows generated between cancellation checks when rendering a snapshot
+    const unsigned int RenderBlockRows = 32;
+    
+    // Rows expanded from the palette per texture update in indexed mode
+    const unsigned int UploadBlockRows = 64;
+    
+    void expandPalette(const std::uint8_t* indices, std::size_t count, std::uint8_t* pixels) {
+        const auto& palette = TerrainSampler::getPalette();
+        for (std::size_t i = 0; i < count; ++i) {
+            const TerrainSampler::Color& color = palette[indices[i]];
+            pixels[i * 4 + 0] = color.r;
+            pixels[i * 4 + 1] = color.g;
+            pixels[i * 4 + 2] = color.b;
+            pixels[i * 4 + 3] = color.a;
+        }
+    }
+    
+    std::vector<PngWriter::PaletteEntry> pngPalette() {
+        std::vector<PngWriter::PaletteEntry> palette;
+        for (const auto& color : TerrainSampler::getPalette()) {
+            palette.push_back(PngWriter::PaletteEntry{color.r, color.g, color.b});
+        }
+        return palette;
+    }
+    
+    // Path with the extension of an image file replaced by a suffix
+    std::string siblingPath(const std::string& filename, const std::string& suffix) {
+        std::size_t dot = filename.find_last_of('.');
+        std::size_t slash = filename.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+            return filename + suffix;
+        }
+        return filename.substr(0, dot) + suffix;
+    }
+}
 
 IslandGenerator::IslandGenerator(unsigned int width, unsigned int height)
     : width(width)
     , height(height)
-    , seaLevel(0.500f)
-    , beachSize(0.030f)
-    , mountainLevel(0.610f)
-    , snowLevel(0.700f)
+    , shading(false)
+    , lighting(TerrainSampler::Lighting::fromAngles(315.0f, 45.0f, 0.25f))
+    , outputMode(OutputMode::Color)
+    , octaveCaching(true)
 {
     if (!renderTexture.create(width, height)) {
         throw std::runtime_error("Failed to create render texture");
@@ -15,129 +55,295 @@ IslandGenerator::IslandGenerator(unsigned int width, unsigned int height)
 }
 
 void IslandGenerator::generate(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence) {
-    sf::Image image;
-    image.create(width, height, sf::Color::Black);
-    
-    // Define multiple island centers with better distribution
-    const int numCenters = 5;
-    struct IslandCenter {
-        float x, y;
-        float influence;
-        float size;
-    };
+    // Generate noise values and apply colors
+    MapGenerator::Settings settings;
+    settings.indexed = outputMode == OutputMode::Indexed;
+    settings.shading = shading;
+    settings.lighting = lighting;
+    settings.octaveCache = octaveCaching;
+    map.generate(terrain, noiseGen, scale, octaves, persistence, width, height, settings);
     
-    IslandCenter centers[numCenters] = {
-        {0.5f, 0.5f, 0.9f, 1.0f},      // Main island
-        {0.25f, 0.3f, 0.7f, 0.8f},     // Left island
-        {0.75f, 0.4f, 0.6f, 0.7f},     // Right island
-        {0.35f, 0.7f, 0.5f, 0.6f},     // Bottom-left island
-        {0.65f, 0.65f, 0.4f, 0.5f}     // Top-right island
-    };
+    if (!map.getNormals().empty()) {
+        sf::Image normalImage;
+        normalImage.create(width, height, map.getNormals().data());
+        normalTexture.loadFromImage(normalImage);
+    }
     
-    // Generate noise values and apply colors
-    for (unsigned int y = 0; y < height; ++y) {
-        for (unsigned int x = 0; x < width; ++x) {
-            // Calculate normalized coordinates
-            float nx = static_cast<float>(x) / width;
-            float ny = static_cast<float>(y) / height;
-            
-            // Get base noise value first
-            float noiseValue = noiseGen.fbm(nx * scale, ny * scale, octaves, persistence);
-            noiseValue = (noiseValue + 1.0f) * 0.5f; // Normalize to [0,1]
-            
-            // Calculate combined gradient from all island centers
-            float maxGradient = 0.0f;
-            for (const auto& center : centers) {
-                float dx = nx - center.x;
-                float dy = ny - center.y;
-                float distanceFromCenter = std::sqrt(dx * dx + dy * dy) / center.size;
-                
-                // Smoother falloff using cubic function
-                float gradient = 0.0f;
-                if (distanceFromCenter < 1.0f) {
-                    gradient = 1.0f - (3.0f * std::pow(distanceFromCenter, 2.0f) - 2.0f * std::pow(distanceFromCenter, 3.0f));
-                    gradient *= center.influence;
-                }
-                
-                maxGradient = std::max(maxGradient, gradient);
-            }
-            
-            // Combine noise and gradient with better blending
-            float finalHeight = noiseValue * maxGradient;
-            
-            // Add some variation to water depth
-            if (finalHeight < seaLevel) {
-                finalHeight *= 0.8f + 0.2f * noiseValue;
-            }
-            
-            // Set pixel color directly
-            image.setPixel(x, y, getTerrainColor(finalHeight));
+    sf::Texture tempTexture;
+    tempTexture.create(width, height);
+    if (outputMode == OutputMode::Indexed) {
+        // Expanded a few rows at a time, the full RGBA map never exists on the CPU
+        const std::vector<std::uint8_t>& indices = map.getIndices();
+        std::vector<std::uint8_t> block(static_cast<std::size_t>(width) * UploadBlockRows * 4);
+        for (unsigned int top = 0; top < height; top += UploadBlockRows) {
+            unsigned int rows = std::min(UploadBlockRows, height - top);
+            expandPalette(indices.data() + static_cast<std::size_t>(top) * width,
+                          static_cast<std::size_t>(rows) * width, block.data());
+            tempTexture.update(block.data(), width, rows, 0, top);
         }
+    } else {
+        tempTexture.update(map.getPixels().data());
     }
     
     // Update the render texture with the generated image
     renderTexture.clear();
-    sf::Texture tempTexture;
-    tempTexture.loadFromImage(image);
     sf::Sprite sprite(tempTexture);
     renderTexture.draw(sprite);
     renderTexture.display();
 }
 
+IslandGenerator::RegionSettings IslandGenerator::getRegionSettings() const {
+    RegionSettings settings;
+    settings.terrain = terrain;
+    settings.shading = shading;
+    settings.lighting = lighting;
+    return settings;
+}
+
+void IslandGenerator::generateRegion(const RegionSettings& settings, const NoiseGenerator& noiseGen,
+                                     float scale, int octaves, float persistence,
+                                     double left, double top, double extent, unsigned int size, std::uint8_t* pixels) {
+    const double step = extent / size;
+    
+    for (unsigned int y = 0; y < size; ++y) {
+        double ny = top + y * step;
+        std::uint8_t* row = pixels + static_cast<std::size_t>(y) * size * 4;
+        for (unsigned int x = 0; x < size; ++x) {
+            double nx = left + x * step;
+            TerrainSampler::Color color = settings.shading
+                ? settings.terrain.sampleShadedColor(noiseGen, nx, ny, scale, octaves, persistence, settings.lighting)
+                : settings.terrain.sampleColor(noiseGen, nx, ny, scale, octaves, persistence);
+            row[x * 4 + 0] = color.r;
+            row[x * 4 + 1] = color.g;
+            row[x * 4 + 2] = color.b;
+            row[x * 4 + 3] = color.a;
+        }
+    }
+}
+
 const sf::Texture& IslandGenerator::getTexture() const {
     return renderTexture.getTexture();
 }
 
+const sf::Texture& IslandGenerator::getNormalTexture() const {
+    return normalTexture;
+}
+
+IslandGenerator::Snapshot IslandGenerator::snapshot(const NoiseGenerator& noiseGen, float scale, int octaves,
+                                                    float persistence) const {
+    Snapshot result = snapshotSettings(noiseGen, scale, octaves, persistence);
+    result.pixels = outputMode == OutputMode::Indexed ? map.getIndices() : map.getPixels();
+    result.normals = map.getNormals();
+    return result;
+}
+
+IslandGenerator::Snapshot IslandGenerator::snapshotSettings(const NoiseGenerator& noiseGen, float scale, int octaves,
+                                                            float persistence) const {
+    Snapshot result;
+    result.width = width;
+    result.height = height;
+    result.outputMode = outputMode;
+    result.shading = shading;
+    result.terrain = terrain;
+    result.lighting = lighting;
+    result.noiseGen = noiseGen;
+    result.scale = scale;
+    result.octaves = octaves;
+    result.persistence = persistence;
+    return result;
+}
+
+bool IslandGenerator::render(Snapshot& snapshot, ExportQueue::Context& context) {
+    const unsigned int w = snapshot.width;
+    const unsigned int h = snapshot.height;
+    const bool indexed = snapshot.outputMode == OutputMode::Indexed;
+    const bool shaded = !indexed && snapshot.shading;
+    const std::size_t stride = indexed ? w : static_cast<std::size_t>(w) * 4;
+    snapshot.pixels.resize(stride * h);
+    snapshot.normals.resize(shaded ? stride * h : 0);
+    
+    // Row blocks, so a cancel doesn't wait for the whole map
+    for (unsigned int top = 0; top < h; top += RenderBlockRows) {
+        if (context.isCancelled()) {
+            return false;
+        }
+        unsigned int rows = std::min(RenderBlockRows, h - top);
+        std::uint8_t* out = snapshot.pixels.data() + top * stride;
+        if (indexed) {
+            snapshot.terrain.generateIndices(snapshot.noiseGen, snapshot.scale, snapshot.octaves, snapshot.persistence,
+                                             w, h, 0, top, w, rows, out, stride);
+        } else if (shaded) {
+            snapshot.terrain.generateShaded(snapshot.noiseGen, snapshot.scale, snapshot.octaves, snapshot.persistence,
+                                            w, h, 0, top, w, rows, snapshot.lighting,
+                                            out, stride, snapshot.normals.data() + top * stride, stride);
+        } else {
+            snapshot.terrain.generateColors(snapshot.noiseGen, snapshot.scale, snapshot.octaves, snapshot.persistence,
+                                            w, h, 0, top, w, rows, out, stride);
+        }
+        context.setProgress(0.5f * (top + rows) / h);
+    }
+    return true;
+}
+
+void IslandGenerator::writeSnapshot(const Snapshot& snapshot, const std::string& filename,
+                                    const ExportOptions& options, ExportQueue::Context& context) {
+    const bool indexed = snapshot.outputMode == OutputMode::Indexed;
+    const bool shaded = !indexed && snapshot.shading && !snapshot.normals.empty();
+    
+    // Progress continues from render() when it ran, each file is an equal share of the rest
+    const float start = context.getProgress();
+    const int files = 1 + (shaded ? 1 : 0) + (options.features ? 1 : 0) + (options.mesh ? 1 : 0);
+    int written = 0;
+    auto next = [&]() {
+        ++written;
+        context.setProgress(start + (1.0f - start) * written / files);
+        return !context.isCancelled();
+    };
+    
+    if (context.isCancelled()) {
+        return;
+    }
+    if (indexed) {
+        std::vector<PngWriter::PaletteEntry> palette = pngPalette();
+        PngWriter::writeIndexed(filename, snapshot.width, snapshot.height, snapshot.pixels.data(), snapshot.width,
+                                palette.data(), palette.size());
+    } else {
+        PngWriter::writeRGBA(filename, snapshot.width, snapshot.height, snapshot.pixels.data(), snapshot.width * 4);
+    }
+    if (!next()) {
+        return;
+    }
+    
+    // The normal map goes next to the shaded image
+    if (shaded) {
+        PngWriter::writeRGBA(siblingPath(filename, "_normal.png"), snapshot.width, snapshot.height,
+                             snapshot.normals.data(), snapshot.width * 4);
+        if (!next()) {
+            return;
+        }
+    }
+    if (options.features) {
+        writeFeatures(siblingPath(filename, "_features.bin"), snapshot.terrain, indexed ? snapshot.pixels.data() : nullptr,
+                      snapshot.width, snapshot.height, snapshot.noiseGen, snapshot.scale, snapshot.octaves,
+                      snapshot.persistence);
+        if (!next()) {
+            return;
+        }
+    }
+    if (options.mesh) {
+        writeMesh(siblingPath(filename, options.meshObj ? "_mesh.obj" : "_mesh.glb"), snapshot.terrain,
+                  snapshot.width, snapshot.height, snapshot.noiseGen, snapshot.scale, snapshot.octaves,
+                  snapshot.persistence, options.meshOptions);
+        next();
+    }
+}
+
 void IslandGenerator::exportToPNG(const std::string& filename) const {
-    if (!renderTexture.getTexture().copyToImage().saveToFile(filename)) {
-        throw std::runtime_error("Failed to save image to file: " + filename);
+    // Written from the buffers the texture was made from, no GPU readback involved
+    if (outputMode == OutputMode::Indexed) {
+        const std::vector<std::uint8_t>& indices = map.getIndices();
+        std::vector<std::uint8_t> rgba(indices.size() * 4);
+        expandPalette(indices.data(), indices.size(), rgba.data());
+        PngWriter::writeRGBA(filename, width, height, rgba.data(), width * 4);
+        return;
+    }
+    PngWriter::writeRGBA(filename, width, height, map.getPixels().data(), width * 4);
+}
+
+void IslandGenerator::exportIndexedPNG(const std::string& filename) const {
+    if (outputMode != OutputMode::Indexed || map.getIndices().empty()) {
+        throw std::runtime_error("Indexed export requires the indexed output mode");
+    }
+    
+    // Written straight from the index buffer, no GPU readback involved
+    std::vector<PngWriter::PaletteEntry> palette = pngPalette();
+    PngWriter::writeIndexed(filename, width, height, map.getIndices().data(), width,
+                            palette.data(), palette.size());
+}
+
+void IslandGenerator::exportNormalMapToPNG(const std::string& filename) const {
+    if (!shading || outputMode != OutputMode::Color || map.getNormals().empty()) {
+        throw std::runtime_error("Normal map is only generated while shading is enabled");
+    }
+    PngWriter::writeRGBA(filename, width, height, map.getNormals().data(), width * 4);
+}
+
+void IslandGenerator::exportFeatures(const std::string& filename, const NoiseGenerator& noiseGen,
+                                     float scale, int octaves, float persistence) const {
+    const bool indexed = outputMode == OutputMode::Indexed && !map.getIndices().empty();
+    writeFeatures(filename, terrain, indexed ? map.getIndices().data() : nullptr, width, height,
+                  noiseGen, scale, octaves, persistence);
+}
+
+void IslandGenerator::exportMesh(const std::string& filename, const NoiseGenerator& noiseGen,
+                                 float scale, int octaves, float persistence, const TerrainMesh::Options& options) const {
+    writeMesh(filename, terrain, width, height, noiseGen, scale, octaves, persistence, options);
+}
+
+void IslandGenerator::writeFeatures(const std::string& filename, const TerrainSampler& terrain,
+                                    const std::uint8_t* classes, unsigned int width, unsigned int height,
+                                    const NoiseGenerator& noiseGen, float scale, int octaves, float persistence) {
+    // Placement works on terrain classes, reuse the indices when they already exist
+    std::vector<std::uint8_t> indices;
+    if (!classes) {
+        indices.resize(static_cast<std::size_t>(width) * height);
+        terrain.generateIndices(noiseGen, scale, octaves, persistence, width, height,
+                                0, 0, width, height, indices.data(), width);
+        classes = indices.data();
     }
+    
+    FeaturePlacer placer;
+    std::vector<FeaturePlacer::Instance> instances = placer.place(classes, width, height, width, noiseGen.getSeed());
+    FeaturePlacer::write(filename, instances, width, height, noiseGen.getSeed());
+}
+
+void IslandGenerator::writeMesh(const std::string& filename, const TerrainSampler& terrain,
+                                unsigned int width, unsigned int height, const NoiseGenerator& noiseGen,
+                                float scale, int octaves, float persistence, const TerrainMesh::Options& options) {
+    // The grid steps cover the whole map, the last row and column lie on its far edges
+    unsigned int gridSize = TerrainMesh::gridSizeFor(width, height);
+    std::vector<float> heights(static_cast<std::size_t>(gridSize) * gridSize);
+    terrain.generateHeights(noiseGen, scale, octaves, persistence, gridSize - 1, gridSize - 1,
+                            0, 0, gridSize, gridSize, heights.data(), gridSize);
+    
+    TerrainMesh::build(heights.data(), gridSize, options).write(filename);
 }
 
 void IslandGenerator::setSeaLevel(float level) {
-    seaLevel = level;
+    terrain.setSeaLevel(level);
 }
 
 void IslandGenerator::setBeachSize(float size) {
-    beachSize = size;
+    terrain.setBeachSize(size);
 }
 
 void IslandGenerator::setMountainLevel(float level) {
-    mountainLevel = level;
+    terrain.setMountainLevel(level);
 }
 
 void IslandGenerator::setSnowLevel(float level) {
-    snowLevel = level;
+    terrain.setSnowLevel(level);
 }
 
-sf::Color IslandGenerator::getTerrainColor(float height) const {
-    if (height < seaLevel - beachSize) {
-        // Deep water
-        return sf::Color(0, 0, 139); // Dark blue
-    }
-    else if (height < seaLevel) {
-        // Shallow water
-        return sf::Color(0, 191, 255); // Deep sky blue
-    }
-    else if (height < seaLevel + beachSize) {
-        // Beach
-        return sf::Color(238, 214, 175); // Sandy
-    }
-    else if (height < mountainLevel) {
-        // Grass/forest
-        float t = (height - (seaLevel + beachSize)) / (mountainLevel - (seaLevel + beachSize));
-        return sf::Color(
-            34 + static_cast<sf::Uint8>(t * (85 - 34)),
-            139 + static_cast<sf::Uint8>(t * (107 - 139)),
-            34 + static_cast<sf::Uint8>(t * (47 - 34))
-        );
-    }
-    else if (height < snowLevel) {
-        // Mountain
-        return sf::Color(139, 137, 137); // Gray
-    }
-    else {
-        // Snow
-        return sf::Color(255, 250, 250); // Snow white
+void IslandGenerator::setClimate(const TerrainSampler::ClimateSettings& settings) {
+    terrain.setClimate(settings);
+}
+
+void IslandGenerator::setShading(bool enabled) {
+    shading = enabled;
+}
+
+void IslandGenerator::setOctaveCache(bool enabled) {
+    octaveCaching = enabled;
+    if (!octaveCaching) {
+        map.clearCache();
     }
-} 
\ No newline at end of file
+}
+
+void IslandGenerator::setOutputMode(OutputMode mode) {
+    outputMode = mode;
+}
+
+void IslandGenerator::setLighting(float azimuth, float elevation, float relief) {
+    lighting = TerrainSampler::Lighting::fromAngles(azimuth, elevation, relief);
+}
\ No newline at end of file
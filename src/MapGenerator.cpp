@@ -0,0 +1,41 @@
+#include "MapGenerator.hpp"
+
+void MapGenerator::generate(const TerrainSampler& terrain, const NoiseGenerator& noiseGen, float scale, int octaves,
+                            float persistence, unsigned int width, unsigned int height, const Settings& settings) {
+    const std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+    if (!settings.octaveCache) {
+        octaveCache.clear();
+    }
+    if (settings.indexed || !settings.shading) {
+        std::vector<std::uint8_t>().swap(normals);
+    }
+
+    if (settings.indexed) {
+        std::vector<std::uint8_t>().swap(pixels);
+        indices.resize(pixelCount);
+        if (settings.octaveCache) {
+            octaveCache.generateIndices(terrain, noiseGen, scale, octaves, persistence, width, height,
+                                        indices.data(), width, &pool);
+        } else {
+            terrain.generateIndices(noiseGen, scale, octaves, persistence, width, height,
+                                    0, 0, width, height, indices.data(), width);
+        }
+        return;
+    }
+
+    std::vector<std::uint8_t>().swap(indices);
+    pixels.resize(pixelCount * 4);
+    if (settings.shading) {
+        // Lit colors and normals come from the same analytic derivatives
+        normals.resize(pixels.size());
+        terrain.generateShaded(noiseGen, scale, octaves, persistence, width, height,
+                               0, 0, width, height, settings.lighting,
+                               pixels.data(), width * 4, normals.data(), width * 4);
+    } else if (settings.octaveCache) {
+        octaveCache.generateColors(terrain, noiseGen, scale, octaves, persistence, width, height,
+                                   pixels.data(), width * 4, &pool);
+    } else {
+        terrain.generateColors(noiseGen, scale, octaves, persistence, width, height,
+                               0, 0, width, height, pixels.data(), width * 4);
+    }
+}
@@ -12,6 +12,17 @@ float NoiseGenerator::noise(float x, float y) const {
     x -= std::floor(x);
     y -= std::floor(y);
     
+    return noiseInCell(X, Y, x, y);
+}
+
+float NoiseGenerator::noise(double x, double y) const {
+    double cellX = std::floor(x);
+    double cellY = std::floor(y);
+    return noiseInCell(static_cast<int>(static_cast<long long>(cellX) & 255), static_cast<int>(static_cast<long long>(cellY) & 255),
+                       static_cast<float>(x - cellX), static_cast<float>(y - cellY));
+}
+
+float NoiseGenerator::noiseInCell(int X, int Y, float x, float y) const {
     // Compute fade curves
     float u = fade(x);
     float v = fade(y);
@@ -33,19 +44,146 @@ float NoiseGenerator::noise(float x, float y) const {
 }
 
 float NoiseGenerator::fbm(float x, float y, int octaves, float persistence) const {
+    OctaveSum sum(*this, x, y, persistence);
+    for (int i = 0; i < octaves; ++i) {
+        sum.addOctave();
+    }
+    return sum.getTotal() / sum.getWeight();
+}
+
+NoiseGenerator::OctaveSum::OctaveSum(const NoiseGenerator& noiseGen, float x, float y, float persistence)
+    : noiseGen(noiseGen)
+    , x(x)
+    , y(y)
+    , persistence(persistence)
+    , total(0.0f)
+    , weight(0.0f)
+    , frequency(1.0f)
+    , amplitude(1.0f)
+{
+}
+
+float NoiseGenerator::fbm(double x, double y, int octaves, float persistence) const {
     float total = 0.0f;
+    float weight = 0.0f;
+    float amplitude = 1.0f;
+    double frequency = 1.0;
+    for (int i = 0; i < octaves; ++i) {
+        total += noise(x * frequency, y * frequency) * amplitude;
+        weight += amplitude;
+        amplitude *= persistence;
+        frequency *= 2.0;
+    }
+    return total / weight;
+}
+
+void NoiseGenerator::OctaveSum::addOctave() {
+    total += noiseGen.noise(x * frequency, y * frequency) * amplitude;
+    weight += amplitude;
+    amplitude *= persistence;
+    frequency *= 2.0f;
+}
+
+NoiseGenerator::Sample NoiseGenerator::noiseWithDerivatives(float x, float y) const {
+    // Get integer coordinates
+    int X = static_cast<int>(std::floor(x)) & 255;
+    int Y = static_cast<int>(std::floor(y)) & 255;
+    
+    // Get decimal part
+    x -= std::floor(x);
+    y -= std::floor(y);
+    
+    return noiseWithDerivativesInCell(X, Y, x, y);
+}
+
+NoiseGenerator::Sample NoiseGenerator::noiseWithDerivatives(double x, double y) const {
+    double cellX = std::floor(x);
+    double cellY = std::floor(y);
+    return noiseWithDerivativesInCell(static_cast<int>(static_cast<long long>(cellX) & 255),
+                                      static_cast<int>(static_cast<long long>(cellY) & 255),
+                                      static_cast<float>(x - cellX), static_cast<float>(y - cellY));
+}
+
+NoiseGenerator::Sample NoiseGenerator::noiseWithDerivativesInCell(int X, int Y, float x, float y) const {
+    // Compute fade curves and their slopes
+    float u = fade(x);
+    float v = fade(y);
+    float du = fadeDerivative(x);
+    float dv = fadeDerivative(y);
+    
+    // Hash coordinates of cube corners
+    int A = hash(X, Y);
+    int B = hash(X + 1, Y);
+    int C = hash(X, Y + 1);
+    int D = hash(X + 1, Y + 1);
+    
+    // Corner contributions, evaluated exactly as in noise()
+    float a = grad(A, x, y);
+    float b = grad(B, x - 1, y);
+    float c = grad(C, x, y - 1);
+    float d = grad(D, x - 1, y - 1);
+    
+    float gax, gay, gbx, gby, gcx, gcy, gdx, gdy;
+    gradVector(A, gax, gay);
+    gradVector(B, gbx, gby);
+    gradVector(C, gcx, gcy);
+    gradVector(D, gdx, gdy);
+    
+    // Expanding the interpolation gives a + u(b - a) + v(c - a) + uv(a - b - c + d),
+    // differentiate each term including the fade curves
+    float k1 = b - a;
+    float k2 = c - a;
+    float k3 = a - b - c + d;
+    
+    Sample sample;
+    sample.value = lerp(lerp(a, b, u), lerp(c, d, u), v);
+    sample.dx = gax + u * (gbx - gax) + v * (gcx - gax) + u * v * (gax - gbx - gcx + gdx) + du * (k1 + k3 * v);
+    sample.dy = gay + u * (gby - gay) + v * (gcy - gay) + u * v * (gay - gby - gcy + gdy) + dv * (k2 + k3 * u);
+    return sample;
+}
+
+NoiseGenerator::Sample NoiseGenerator::fbmWithDerivatives(float x, float y, int octaves, float persistence) const {
+    Sample total{0.0f, 0.0f, 0.0f};
     float frequency = 1.0f;
     float amplitude = 1.0f;
     float maxValue = 0.0f;
     
     for (int i = 0; i < octaves; ++i) {
-        total += noise(x * frequency, y * frequency) * amplitude;
+        Sample octave = noiseWithDerivatives(x * frequency, y * frequency);
+        total.value += octave.value * amplitude;
+        total.dx += octave.dx * amplitude * frequency;
+        total.dy += octave.dy * amplitude * frequency;
         maxValue += amplitude;
         amplitude *= persistence;
         frequency *= 2.0f;
     }
     
-    return total / maxValue;
+    total.value /= maxValue;
+    total.dx /= maxValue;
+    total.dy /= maxValue;
+    return total;
+}
+
+NoiseGenerator::Sample NoiseGenerator::fbmWithDerivatives(double x, double y, int octaves, float persistence) const {
+    Sample total{0.0f, 0.0f, 0.0f};
+    double frequency = 1.0;
+    float amplitude = 1.0f;
+    float maxValue = 0.0f;
+    
+    for (int i = 0; i < octaves; ++i) {
+        Sample octave = noiseWithDerivatives(x * frequency, y * frequency);
+        total.value += octave.value * amplitude;
+        total.dx += octave.dx * amplitude * static_cast<float>(frequency);
+        total.dy += octave.dy * amplitude * static_cast<float>(frequency);
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= 2.0;
+    }
+    
+    total.value /= maxValue;
+    total.dx /= maxValue;
+    total.dy /= maxValue;
+    return total;
 }
 
 void NoiseGenerator::setSeed(int newSeed) {
@@ -60,6 +198,10 @@ float NoiseGenerator::fade(float t) const {
     return t * t * t * (t * (t * 6 - 15) + 10);
 }
 
+float NoiseGenerator::fadeDerivative(float t) const {
+    return 30 * t * t * (t * (t - 2) + 1);
+}
+
 float NoiseGenerator::lerp(float a, float b, float t) const {
     return a + t * (b - a);
 }
@@ -71,6 +213,20 @@ float NoiseGenerator::grad(int hash, float x, float y) const {
     return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
 }
 
+void NoiseGenerator::gradVector(int hash, float& gx, float& gy) const {
+    // Gradient of grad(), which is linear in x and y
+    int h = hash & 15;
+    float su = (h & 1) == 0 ? 1.0f : -1.0f;
+    float sv = (h & 2) == 0 ? 1.0f : -1.0f;
+    gx = h < 8 ? su : 0.0f;
+    gy = h < 8 ? 0.0f : su;
+    if (h < 4) {
+        gy += sv;
+    } else if (h == 12 || h == 14) {
+        gx += sv;
+    }
+}
+
 int NoiseGenerator::hash(int x, int y) const {
     int hash = (seed * 1234567 + x * 2345678 + y * 3456789) & 255;
     hash = ((hash << 13) ^ hash) * (hash * (hash * hash * 15731 + 789221) + 1376312589);
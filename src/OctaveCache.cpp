@@ -0,0 +1,214 @@
+#include "OctaveCache.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace {
+    // Rows per task when generating and combining
+    const unsigned int BlockRows = 16;
+
+    // Pixels of a row combined at a time, small enough for the stack and the L1 cache
+    const unsigned int CombinePixels = 2048;
+}
+
+template <typename Task>
+void OctaveCache::forEachBlock(unsigned int height, WorkerPool* pool, const Task& task) {
+    auto block = [&](int index) {
+        unsigned int top = static_cast<unsigned int>(index) * BlockRows;
+        task(top, std::min(BlockRows, height - top));
+    };
+    int blocks = static_cast<int>((height + BlockRows - 1) / BlockRows);
+    if (pool) {
+        pool->parallelFor(blocks, block);
+    } else {
+        for (int index = 0; index < blocks; ++index) {
+            block(index);
+        }
+    }
+}
+
+OctaveCache::OctaveCache(std::size_t memoryBudget)
+    : memoryBudget(memoryBudget)
+{
+}
+
+void OctaveCache::setMemoryBudget(std::size_t bytes) {
+    memoryBudget = bytes;
+    if (masks.empty()) {
+        return;
+    }
+    int fit = layersWithinBudget(cachedKey.width, cachedKey.height);
+    if (fit == 0) {
+        clear();
+    } else if (layers.size() > static_cast<std::size_t>(fit)) {
+        layers.resize(static_cast<std::size_t>(fit));
+    }
+}
+
+void OctaveCache::clear() {
+    std::vector<float>().swap(masks);
+    layers.clear();
+    cachedKey = Key();
+}
+
+std::size_t OctaveCache::getMemoryUsage() const {
+    std::size_t bytes = masks.size() * sizeof(float);
+    for (const auto& layer : layers) {
+        bytes += layer.size() * sizeof(float);
+    }
+    return bytes;
+}
+
+int OctaveCache::layersWithinBudget(unsigned int width, unsigned int height) const {
+    const std::size_t pixels = static_cast<std::size_t>(width) * height;
+    const std::size_t maskBytes = pixels * sizeof(float);
+    const std::size_t layerBytes = pixels * sizeof(float);
+    if (layerBytes == 0 || memoryBudget < maskBytes + layerBytes) {
+        return 0;
+    }
+    return static_cast<int>(std::min<std::size_t>((memoryBudget - maskBytes) / layerBytes, INT_MAX));
+}
+
+bool OctaveCache::prepare(const TerrainSampler& terrain, const NoiseGenerator& noiseGen, float scale, int octaves,
+                          unsigned int width, unsigned int height, WorkerPool* pool) {
+    Key key;
+    key.seed = noiseGen.getSeed();
+    key.scale = scale;
+    key.width = width;
+    key.height = height;
+
+    bool repeated = (key == cachedKey && !masks.empty()) || key == lastKey;
+    lastKey = key;
+    int fit = layersWithinBudget(width, height);
+    if (!repeated || fit == 0 || octaves < 1) {
+        return false;
+    }
+
+    if (!(key == cachedKey) || masks.empty()) {
+        clear();
+        cachedKey = key;
+        masks.resize(static_cast<std::size_t>(width) * height);
+        forEachBlock(height, pool, [&](unsigned int top, unsigned int rows) {
+            for (unsigned int y = top; y < top + rows; ++y) {
+                float ny = static_cast<float>(y) / height;
+                float* row = masks.data() + static_cast<std::size_t>(y) * width;
+                for (unsigned int x = 0; x < width; ++x) {
+                    row[x] = terrain.sampleMask(static_cast<float>(x) / width, ny);
+                }
+            }
+        });
+    }
+
+    // Only the octaves that aren't cached yet are evaluated
+    const std::size_t wanted = static_cast<std::size_t>(std::min(octaves, fit));
+    while (layers.size() < wanted) {
+        float frequency = 1.0f;
+        for (std::size_t i = 0; i < layers.size(); ++i) {
+            frequency *= 2.0f;
+        }
+
+        layers.emplace_back(static_cast<std::size_t>(width) * height);
+        float* layer = layers.back().data();
+        forEachBlock(height, pool, [&](unsigned int top, unsigned int rows) {
+            for (unsigned int y = top; y < top + rows; ++y) {
+                // Same coordinates as fbm() gets from TerrainSampler
+                float fy = static_cast<float>(y) / height * scale;
+                float* row = layer + static_cast<std::size_t>(y) * width;
+                for (unsigned int x = 0; x < width; ++x) {
+                    float fx = static_cast<float>(x) / width * scale;
+                    row[x] = noiseGen.noise(fx * frequency, fy * frequency);
+                }
+            }
+        });
+    }
+    return true;
+}
+
+void OctaveCache::combine(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                          unsigned int width, unsigned int height, unsigned int left, unsigned int y,
+                          unsigned int columns, float* noise) const {
+    const std::size_t offset = static_cast<std::size_t>(y) * width + left;
+    std::fill(noise, noise + columns, 0.0f);
+
+    // Weighted sum of the cached layers in the order fbm() adds the octaves, so the
+    // result is exactly the same. A plain loop over floats that vectorizes.
+    const int cached = std::min(octaves, static_cast<int>(layers.size()));
+    float amplitude = 1.0f;
+    float frequency = 1.0f;
+    float weight = 0.0f;
+    for (int i = 0; i < cached; ++i) {
+        const float* layer = layers[static_cast<std::size_t>(i)].data() + offset;
+        for (unsigned int x = 0; x < columns; ++x) {
+            noise[x] += layer[x] * amplitude;
+        }
+        weight += amplitude;
+        amplitude *= persistence;
+        frequency *= 2.0f;
+    }
+
+    // Octaves over the memory budget
+    const float fy = static_cast<float>(y) / height * scale;
+    for (int i = cached; i < octaves; ++i) {
+        for (unsigned int x = 0; x < columns; ++x) {
+            float fx = static_cast<float>(left + x) / width * scale;
+            noise[x] += noiseGen.noise(fx * frequency, fy * frequency) * amplitude;
+        }
+        weight += amplitude;
+        amplitude *= persistence;
+        frequency *= 2.0f;
+    }
+
+    for (unsigned int x = 0; x < columns; ++x) {
+        noise[x] /= weight;
+    }
+}
+
+template <typename Convert>
+void OctaveCache::forEachSegment(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                                 unsigned int width, unsigned int height, WorkerPool* pool, const Convert& convert) const {
+    forEachBlock(height, pool, [&](unsigned int top, unsigned int rows) {
+        float noise[CombinePixels];
+        for (unsigned int y = top; y < top + rows; ++y) {
+            for (unsigned int left = 0; left < width; left += CombinePixels) {
+                unsigned int columns = std::min(CombinePixels, width - left);
+                combine(noiseGen, scale, octaves, persistence, width, height, left, y, columns, noise);
+                convert(noise, masks.data() + static_cast<std::size_t>(y) * width + left, left, y, columns);
+            }
+        }
+    });
+}
+
+void OctaveCache::generateColors(const TerrainSampler& terrain, const NoiseGenerator& noiseGen,
+                                 float scale, int octaves, float persistence, unsigned int width, unsigned int height,
+                                 std::uint8_t* pixels, std::size_t stride, WorkerPool* pool) {
+    if (!prepare(terrain, noiseGen, scale, octaves, width, height, pool)) {
+        forEachBlock(height, pool, [&](unsigned int top, unsigned int rows) {
+            terrain.generateColors(noiseGen, scale, octaves, persistence, width, height,
+                                   0, top, width, rows, pixels + top * stride, stride);
+        });
+        return;
+    }
+
+    forEachSegment(noiseGen, scale, octaves, persistence, width, height, pool,
+                   [&](const float* noise, const float* masks, unsigned int left, unsigned int y, unsigned int columns) {
+        terrain.colorsFromNoise(noiseGen, noise, masks, columns, width, height, left, y, columns, 1,
+                                pixels + y * stride + left * 4, stride);
+    });
+}
+
+void OctaveCache::generateIndices(const TerrainSampler& terrain, const NoiseGenerator& noiseGen,
+                                  float scale, int octaves, float persistence, unsigned int width, unsigned int height,
+                                  std::uint8_t* indices, std::size_t stride, WorkerPool* pool) {
+    if (!prepare(terrain, noiseGen, scale, octaves, width, height, pool)) {
+        forEachBlock(height, pool, [&](unsigned int top, unsigned int rows) {
+            terrain.generateIndices(noiseGen, scale, octaves, persistence, width, height,
+                                    0, top, width, rows, indices + top * stride, stride);
+        });
+        return;
+    }
+
+    forEachSegment(noiseGen, scale, octaves, persistence, width, height, pool,
+                   [&](const float* noise, const float* masks, unsigned int left, unsigned int y, unsigned int columns) {
+        terrain.indicesFromNoise(noiseGen, noise, masks, columns, width, height, left, y, columns, 1,
+                                 indices + y * stride + left, stride);
+    });
+}
@@ -0,0 +1,305 @@
+#include "PngWriter.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    const std::uint32_t* crcTable() {
+        static std::uint32_t table[256];
+        static bool initialized = [] {
+            for (std::uint32_t n = 0; n < 256; ++n) {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                table[n] = c;
+            }
+            return true;
+        }();
+        (void)initialized;
+        return table;
+    }
+
+    std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0) {
+        const std::uint32_t* table = crcTable();
+        crc = ~crc;
+        for (std::size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    std::uint32_t adler32(const std::uint8_t* data, std::size_t size) {
+        std::uint32_t a = 1;
+        std::uint32_t b = 0;
+        while (size > 0) {
+            // Largest run that can't overflow before taking the modulus
+            std::size_t run = size < 5552 ? size : 5552;
+            size -= run;
+            while (run-- > 0) {
+                a += *data++;
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void putBigEndian(std::vector<std::uint8_t>& out, std::uint32_t value) {
+        out.push_back(static_cast<std::uint8_t>(value >> 24));
+        out.push_back(static_cast<std::uint8_t>(value >> 16));
+        out.push_back(static_cast<std::uint8_t>(value >> 8));
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    void putChunk(std::vector<std::uint8_t>& out, const char* type, const std::vector<std::uint8_t>& data) {
+        putBigEndian(out, static_cast<std::uint32_t>(data.size()));
+        std::size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        putBigEndian(out, crc32(out.data() + start, out.size() - start));
+    }
+
+    // Deflate writes bits starting with the least significant one
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<std::uint8_t>& out) : out(out), buffer(0), count(0) {}
+
+        void write(std::uint32_t bits, int length) {
+            buffer |= static_cast<std::uint64_t>(bits) << count;
+            count += length;
+            while (count >= 8) {
+                out.push_back(static_cast<std::uint8_t>(buffer));
+                buffer >>= 8;
+                count -= 8;
+            }
+        }
+
+        // Huffman codes are defined most significant bit first
+        void writeCode(std::uint32_t code, int length) {
+            std::uint32_t reversed = 0;
+            for (int i = 0; i < length; ++i) {
+                reversed = (reversed << 1) | ((code >> i) & 1);
+            }
+            write(reversed, length);
+        }
+
+        void flush() {
+            if (count > 0) {
+                out.push_back(static_cast<std::uint8_t>(buffer));
+            }
+            buffer = 0;
+            count = 0;
+        }
+
+    private:
+        std::vector<std::uint8_t>& out;
+        std::uint64_t buffer;
+        int count;
+    };
+
+    void writeLiteral(BitWriter& bits, int symbol) {
+        // Fixed Huffman code lengths from RFC 1951 section 3.2.6
+        if (symbol < 144) {
+            bits.writeCode(0x30 + symbol, 8);
+        } else if (symbol < 256) {
+            bits.writeCode(0x190 + symbol - 144, 9);
+        } else if (symbol < 280) {
+            bits.writeCode(symbol - 256, 7);
+        } else {
+            bits.writeCode(0xc0 + symbol - 280, 8);
+        }
+    }
+
+    void writeMatch(BitWriter& bits, int length, int distance) {
+        static const int lengthBase[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+        };
+        static const int lengthExtra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+        };
+        static const int distanceBase[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+        };
+        static const int distanceExtra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+        };
+
+        int lengthCode = 28;
+        while (lengthBase[lengthCode] > length) {
+            --lengthCode;
+        }
+        writeLiteral(bits, 257 + lengthCode);
+        bits.write(length - lengthBase[lengthCode], lengthExtra[lengthCode]);
+
+        int distanceCode = 29;
+        while (distanceBase[distanceCode] > distance) {
+            --distanceCode;
+        }
+        bits.writeCode(distanceCode, 5);
+        bits.write(distance - distanceBase[distanceCode], distanceExtra[distanceCode]);
+    }
+
+    // zlib stream of a single fixed Huffman block with greedy hash-based matching
+    std::vector<std::uint8_t> compress(const std::vector<std::uint8_t>& data) {
+        const int hashBits = 15;
+        const std::size_t windowSize = 32768;
+        const std::size_t minMatch = 3;
+        const std::size_t maxMatch = 258;
+
+        std::vector<std::uint8_t> out;
+        out.reserve(data.size() / 4 + 64);
+        out.push_back(0x78);
+        out.push_back(0x01);
+
+        BitWriter bits(out);
+        bits.write(1, 1); // Final block
+        bits.write(1, 2); // Fixed Huffman codes
+
+        std::vector<std::int64_t> head(std::size_t(1) << hashBits, -1);
+        auto hashAt = [&](std::size_t i) {
+            std::uint32_t value = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+            return (value * 2654435761u) >> (32 - hashBits);
+        };
+
+        std::size_t i = 0;
+        while (i < data.size()) {
+            std::size_t bestLength = 0;
+            std::size_t bestDistance = 0;
+
+            if (i + minMatch <= data.size()) {
+                std::uint32_t h = hashAt(i);
+                std::int64_t candidate = head[h];
+                head[h] = static_cast<std::int64_t>(i);
+
+                if (candidate >= 0 && i - candidate <= windowSize) {
+                    std::size_t limit = std::min(maxMatch, data.size() - i);
+                    std::size_t length = 0;
+                    while (length < limit && data[candidate + length] == data[i + length]) {
+                        ++length;
+                    }
+                    if (length >= minMatch) {
+                        bestLength = length;
+                        bestDistance = i - static_cast<std::size_t>(candidate);
+                    }
+                }
+            }
+
+            if (bestLength > 0) {
+                writeMatch(bits, static_cast<int>(bestLength), static_cast<int>(bestDistance));
+                // Keep the hash chain warm inside the match without searching
+                std::size_t end = i + bestLength;
+                for (++i; i < end; ++i) {
+                    if (i + minMatch <= data.size()) {
+                        head[hashAt(i)] = static_cast<std::int64_t>(i);
+                    }
+                }
+            } else {
+                writeLiteral(bits, data[i]);
+                ++i;
+            }
+        }
+
+        writeLiteral(bits, 256); // End of block
+        bits.flush();
+        putBigEndian(out, adler32(data.data(), data.size()));
+        return out;
+    }
+
+    void writeFile(const std::string& filename, const std::vector<std::uint8_t>& png) {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()))) {
+            throw std::runtime_error("Failed to save image to file: " + filename);
+        }
+    }
+}
+
+std::vector<std::uint8_t> PngWriter::encodeIndexed(unsigned int width, unsigned int height,
+                                                   const std::uint8_t* indices, std::size_t stride,
+                                                   const PaletteEntry* palette, std::size_t paletteSize) {
+    if (width == 0 || height == 0 || paletteSize == 0 || paletteSize > 256) {
+        throw std::runtime_error("Invalid indexed image dimensions or palette size");
+    }
+
+    // Palette images compress best without a scanline filter
+    std::vector<std::uint8_t> scanlines;
+    scanlines.reserve((static_cast<std::size_t>(width) + 1) * height);
+    for (unsigned int y = 0; y < height; ++y) {
+        scanlines.push_back(0);
+        const std::uint8_t* row = indices + y * stride;
+        scanlines.insert(scanlines.end(), row, row + width);
+    }
+
+    std::vector<std::uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    std::vector<std::uint8_t> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.push_back(8); // Bit depth
+    header.push_back(3); // Palette color type
+    header.push_back(0); // Deflate
+    header.push_back(0); // Adaptive filtering
+    header.push_back(0); // No interlace
+    putChunk(png, "IHDR", header);
+
+    std::vector<std::uint8_t> colors;
+    for (std::size_t i = 0; i < paletteSize; ++i) {
+        colors.push_back(palette[i].r);
+        colors.push_back(palette[i].g);
+        colors.push_back(palette[i].b);
+    }
+    putChunk(png, "PLTE", colors);
+    putChunk(png, "IDAT", compress(scanlines));
+    putChunk(png, "IEND", std::vector<std::uint8_t>());
+    return png;
+}
+
+void PngWriter::writeIndexed(const std::string& filename, unsigned int width, unsigned int height,
+                             const std::uint8_t* indices, std::size_t stride,
+                             const PaletteEntry* palette, std::size_t paletteSize) {
+    writeFile(filename, encodeIndexed(width, height, indices, stride, palette, paletteSize));
+}
+
+std::vector<std::uint8_t> PngWriter::encodeRGBA(unsigned int width, unsigned int height,
+                                                const std::uint8_t* pixels, std::size_t stride) {
+    if (width == 0 || height == 0) {
+        throw std::runtime_error("Invalid RGBA image dimensions");
+    }
+
+    // The Sub filter turns flat terrain into runs of zeros that match well
+    const std::size_t rowBytes = static_cast<std::size_t>(width) * 4;
+    std::vector<std::uint8_t> scanlines((rowBytes + 1) * height);
+    for (unsigned int y = 0; y < height; ++y) {
+        std::uint8_t* out = scanlines.data() + y * (rowBytes + 1);
+        const std::uint8_t* row = pixels + y * stride;
+        out[0] = 1;
+        for (std::size_t i = 0; i < rowBytes; ++i) {
+            out[i + 1] = static_cast<std::uint8_t>(row[i] - (i >= 4 ? row[i - 4] : 0));
+        }
+    }
+
+    std::vector<std::uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    std::vector<std::uint8_t> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.push_back(8); // Bit depth
+    header.push_back(6); // RGBA color type
+    header.push_back(0); // Deflate
+    header.push_back(0); // Adaptive filtering
+    header.push_back(0); // No interlace
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", compress(scanlines));
+    putChunk(png, "IEND", std::vector<std::uint8_t>());
+    return png;
+}
+
+void PngWriter::writeRGBA(const std::string& filename, unsigned int width, unsigned int height,
+                          const std::uint8_t* pixels, std::size_t stride) {
+    writeFile(filename, encodeRGBA(width, height, pixels, stride));
+}
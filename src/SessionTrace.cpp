@@ -0,0 +1,174 @@
+#include "SessionTrace.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    const char* const Header = "# islandgen session 1";
+    const char* const LatencyNote = "# took: milliseconds until the map view showed every tile of the change";
+
+    // Writes the fields that differ from the previous parameters, or all of them
+    class FieldWriter {
+    public:
+        FieldWriter(std::ostream& out, bool all) : out(out), all(all) {}
+
+        template <typename T>
+        void field(const char* name, const T& previous, const T& current) {
+            if (all || previous != current) {
+                out << ' ' << name << '=' << current;
+            }
+        }
+
+        void field(const char* name, bool previous, bool current) {
+            if (all || previous != current) {
+                out << ' ' << name << '=' << (current ? 1 : 0);
+            }
+        }
+
+    private:
+        std::ostream& out;
+        bool all;
+    };
+
+    void writeFields(std::ostream& out, const SessionTrace::Parameters& previous,
+                     const SessionTrace::Parameters& current, bool all) {
+        FieldWriter writer(out, all);
+        writer.field("seed", previous.seed, current.seed);
+        writer.field("scale", previous.scale, current.scale);
+        writer.field("octaves", previous.octaves, current.octaves);
+        writer.field("persistence", previous.persistence, current.persistence);
+        writer.field("seaLevel", previous.seaLevel, current.seaLevel);
+        writer.field("beachSize", previous.beachSize, current.beachSize);
+        writer.field("mountainLevel", previous.mountainLevel, current.mountainLevel);
+        writer.field("snowLevel", previous.snowLevel, current.snowLevel);
+        writer.field("shading", previous.shading, current.shading);
+        writer.field("lightAzimuth", previous.lightAzimuth, current.lightAzimuth);
+        writer.field("lightElevation", previous.lightElevation, current.lightElevation);
+        writer.field("relief", previous.relief, current.relief);
+        writer.field("indexed", previous.indexed, current.indexed);
+        writer.field("octaveCache", previous.octaveCache, current.octaveCache);
+        writer.field("climate", previous.climate.enabled, current.climate.enabled);
+        writer.field("climateScale", previous.climate.scale, current.climate.scale);
+        writer.field("climateOctaves", previous.climate.octaves, current.climate.octaves);
+        writer.field("moistureSeedOffset", previous.climate.moistureSeedOffset, current.climate.moistureSeedOffset);
+        writer.field("temperatureSeedOffset", previous.climate.temperatureSeedOffset, current.climate.temperatureSeedOffset);
+        writer.field("lapseRate", previous.climate.lapseRate, current.climate.lapseRate);
+    }
+
+    // Apply one key=value pair, returns false for unknown keys or malformed values
+    bool readField(SessionTrace::Parameters& parameters, const std::string& key, const std::string& value) {
+        std::istringstream in(value);
+        if (key == "seed") in >> parameters.seed;
+        else if (key == "scale") in >> parameters.scale;
+        else if (key == "octaves") in >> parameters.octaves;
+        else if (key == "persistence") in >> parameters.persistence;
+        else if (key == "seaLevel") in >> parameters.seaLevel;
+        else if (key == "beachSize") in >> parameters.beachSize;
+        else if (key == "mountainLevel") in >> parameters.mountainLevel;
+        else if (key == "snowLevel") in >> parameters.snowLevel;
+        else if (key == "shading") in >> parameters.shading;
+        else if (key == "lightAzimuth") in >> parameters.lightAzimuth;
+        else if (key == "lightElevation") in >> parameters.lightElevation;
+        else if (key == "relief") in >> parameters.relief;
+        else if (key == "indexed") in >> parameters.indexed;
+        else if (key == "octaveCache") in >> parameters.octaveCache;
+        else if (key == "climate") in >> parameters.climate.enabled;
+        else if (key == "climateScale") in >> parameters.climate.scale;
+        else if (key == "climateOctaves") in >> parameters.climate.octaves;
+        else if (key == "moistureSeedOffset") in >> parameters.climate.moistureSeedOffset;
+        else if (key == "temperatureSeedOffset") in >> parameters.climate.temperatureSeedOffset;
+        else if (key == "lapseRate") in >> parameters.climate.lapseRate;
+        else return false;
+        return !in.fail();
+    }
+}
+
+SessionTrace::Recorder::Recorder(const std::string& filename, unsigned int width, unsigned int height)
+    : file(filename)
+    , start(std::chrono::steady_clock::now())
+    , first(true)
+{
+    if (!file) {
+        throw std::runtime_error("Failed to create session trace: " + filename);
+    }
+    // Enough digits for every float to read back exactly
+    file << std::setprecision(9);
+    file << Header << '\n' << LatencyNote << '\n' << "size " << width << ' ' << height << '\n';
+}
+
+void SessionTrace::Recorder::record(const Parameters& parameters, double latency, bool shown) {
+    // The change itself happened latency earlier
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double time = std::max(0.0, elapsed - latency);
+    file << std::fixed << std::setprecision(3) << time << std::defaultfloat << std::setprecision(9);
+    writeFields(file, previous, parameters, first);
+    if (shown) {
+        file << std::fixed << std::setprecision(3) << " took=" << latency << std::defaultfloat << std::setprecision(9);
+    }
+    file << '\n';
+    file.flush();
+
+    previous = parameters;
+    first = false;
+}
+
+SessionTrace SessionTrace::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Failed to open session trace: " + filename);
+    }
+
+    SessionTrace trace;
+    Parameters current;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream in(line);
+        if (line.compare(0, 5, "size ") == 0) {
+            std::string keyword;
+            in >> keyword >> trace.width >> trace.height;
+            if (in.fail()) {
+                throw std::runtime_error("Malformed size in " + filename + " line " + std::to_string(lineNumber));
+            }
+            continue;
+        }
+
+        Event event;
+        event.recordedLatency = -1.0;
+        if (!(in >> event.time)) {
+            throw std::runtime_error("Missing timestamp in " + filename + " line " + std::to_string(lineNumber));
+        }
+
+        std::string pair;
+        while (in >> pair) {
+            std::size_t separator = pair.find('=');
+            if (separator == std::string::npos) {
+                throw std::runtime_error("Malformed field '" + pair + "' in " + filename + " line " + std::to_string(lineNumber));
+            }
+            std::string key = pair.substr(0, separator);
+            std::string value = pair.substr(separator + 1);
+            if (key == "took") {
+                std::istringstream took(value);
+                if (!(took >> event.recordedLatency)) {
+                    throw std::runtime_error("Malformed field '" + pair + "' in " + filename + " line " + std::to_string(lineNumber));
+                }
+            } else if (!readField(current, key, value)) {
+                throw std::runtime_error("Unknown field '" + pair + "' in " + filename + " line " + std::to_string(lineNumber));
+            }
+        }
+
+        event.parameters = current;
+        trace.events.push_back(event);
+    }
+
+    if (trace.width == 0 || trace.height == 0) {
+        throw std::runtime_error("Session trace has no map size: " + filename);
+    }
+    return trace;
+}
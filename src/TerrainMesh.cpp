@@ -0,0 +1,440 @@
+#include "TerrainMesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    const std::uint32_t GlbMagic = 0x46546C67;      // "glTF"
+    const std::uint32_t GlbVersion = 2;
+    const std::uint32_t GlbJsonChunk = 0x4E4F534A;  // "JSON"
+    const std::uint32_t GlbBinaryChunk = 0x004E4942; // "BIN\0"
+
+    // Bisection steps when searching the error bound for a triangle budget
+    const int BudgetSearchSteps = 40;
+
+    // Error of every triangle, stored at the midpoint of its hypotenuse. Every grid
+    // vertex except the corners is the midpoint of exactly one hypotenuse, shared by
+    // one triangle on the border and by two inside.
+    class ErrorGrid {
+    public:
+        ErrorGrid(const float* heights, int size)
+            : heights(heights)
+            , size(size)
+            , tileSize(size - 1)
+            , errors(static_cast<std::size_t>(size) * size, 0.0f)
+        {
+            // Smallest triangles first, so the children of a triangle are always done
+            // before it. At each step s the hypotenuses along the grid axes have length
+            // 2s and are the children of the diagonal ones of squares with edge 2s.
+            for (int s = 1; s < tileSize; s *= 2) {
+                bool hasChildren = s > 1;
+                for (int y = 0; y <= tileSize; y += 2 * s) {
+                    for (int x = s; x < tileSize; x += 2 * s) {
+                        merge(x, y, x - s, y, x + s, y, x, y - s, hasChildren);
+                        merge(x, y, x - s, y, x + s, y, x, y + s, hasChildren);
+                    }
+                }
+                for (int y = s; y < tileSize; y += 2 * s) {
+                    for (int x = 0; x <= tileSize; x += 2 * s) {
+                        merge(x, y, x, y - s, x, y + s, x - s, y, hasChildren);
+                        merge(x, y, x, y - s, x, y + s, x + s, y, hasChildren);
+                    }
+                }
+
+                // The diagonals of neighboring squares alternate, all of them meet at
+                // the center of the square one step up
+                for (int y = s; y < tileSize; y += 2 * s) {
+                    for (int x = s; x < tileSize; x += 2 * s) {
+                        if ((((x - y) / (2 * s)) & 1) == 0) {
+                            merge(x, y, x - s, y - s, x + s, y + s, x + s, y - s, true);
+                            merge(x, y, x - s, y - s, x + s, y + s, x - s, y + s, true);
+                        } else {
+                            merge(x, y, x - s, y + s, x + s, y - s, x - s, y - s, true);
+                            merge(x, y, x - s, y + s, x + s, y - s, x + s, y + s, true);
+                        }
+                    }
+                }
+            }
+        }
+
+        float at(int x, int y) const {
+            return errors[index(x, y)];
+        }
+
+        float getMaxError() const {
+            return *std::max_element(errors.begin(), errors.end());
+        }
+
+        // Triangles in the mesh for an error bound, each split adds one
+        std::size_t countTriangles(float threshold) const {
+            std::size_t count = 2;
+            for (int y = 0; y <= tileSize; ++y) {
+                const float* row = errors.data() + index(0, y);
+                bool borderRow = y == 0 || y == tileSize;
+                for (int x = 0; x <= tileSize; ++x) {
+                    if (row[x] > threshold) {
+                        count += borderRow || x == 0 || x == tileSize ? 1 : 2;
+                    }
+                }
+            }
+            return count;
+        }
+
+    private:
+        const float* heights;
+        int size;
+        int tileSize;
+        std::vector<float> errors;
+
+        std::size_t index(int x, int y) const {
+            return static_cast<std::size_t>(y) * size + x;
+        }
+
+        // Where an edge crosses the rows of a triangle, starting at its top row
+        struct Crossing {
+            int x;
+            int step;
+            bool leftBound;     // The triangle lies right of the edge
+        };
+
+        // Edges of the triangles are horizontal, vertical or diagonal, so they cross every
+        // row at a grid point, moving by at most one step per row. r is the third corner.
+        static Crossing crossing(int px, int py, int qx, int qy, int rx, int ry, int top) {
+            if (py == qy) {
+                // Horizontal edges only bound the rows
+                return Crossing{std::numeric_limits<int>::min(), 0, true};
+            }
+            int step = (qx - px) / (qy - py);
+            return Crossing{px + step * (top - py), step, rx > px + step * (ry - py)};
+        }
+
+        // Largest distance between the plane through a, b and c and the heights of the
+        // grid points inside or on the triangle
+        float triangleError(int ax, int ay, int bx, int by, int cx, int cy) const {
+            const float ha = heights[index(ax, ay)];
+            const float hb = heights[index(bx, by)];
+            const float hc = heights[index(cx, cy)];
+            const float inverseArea = 1.0f / static_cast<float>((bx - ax) * (cy - ay) - (by - ay) * (cx - ax));
+            const float slopeX = (ha * (by - cy) + hb * (cy - ay) + hc * (ay - by)) * inverseArea;
+            const float slopeY = (ha * (cx - bx) + hb * (ax - cx) + hc * (bx - ax)) * inverseArea;
+
+            const int top = std::min({ay, by, cy});
+            const int bottom = std::max({ay, by, cy});
+            const Crossing edges[3] = {
+                crossing(ax, ay, bx, by, cx, cy, top),
+                crossing(bx, by, cx, cy, ax, ay, top),
+                crossing(cx, cy, ax, ay, bx, by, top)
+            };
+
+            // Four running maxima so consecutive points don't wait on each other
+            float worst[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            for (int y = top; y <= bottom; ++y) {
+                int left = std::min({ax, bx, cx});
+                int right = std::max({ax, bx, cx});
+                for (const Crossing& edge : edges) {
+                    int x = edge.x + edge.step * (y - top);
+                    if (edge.leftBound) {
+                        left = std::max(left, x);
+                    } else {
+                        right = std::min(right, x);
+                    }
+                }
+
+                const float* row = heights + index(left, y);
+                const float start = ha + slopeX * (left - ax) + slopeY * (y - ay);
+                const int count = right - left + 1;
+                int i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    for (int lane = 0; lane < 4; ++lane) {
+                        float plane = start + slopeX * (i + lane);
+                        worst[lane] = std::max(worst[lane], std::fabs(plane - row[i + lane]));
+                    }
+                }
+                for (; i < count; ++i) {
+                    worst[0] = std::max(worst[0], std::fabs(start + slopeX * i - row[i]));
+                }
+            }
+            return std::max(std::max(worst[0], worst[1]), std::max(worst[2], worst[3]));
+        }
+
+        // Merge the error of the triangle with hypotenuse a-b and its right angle at c
+        // into the hypotenuse midpoint m, together with the errors of its children. The
+        // children only cover the triangle's grid points for their own planes, so its
+        // own error is measured over all of them rather than at the midpoint alone.
+        void merge(int mx, int my, int ax, int ay, int bx, int by, int cx, int cy, bool hasChildren) {
+            if (cx < 0 || cy < 0 || cx > tileSize || cy > tileSize) {
+                return;
+            }
+            // The smallest triangles have no grid points off their edges, and those on
+            // the legs are the children's hypotenuse midpoints
+            float error = std::abs(ax - cx) + std::abs(ay - cy) <= 2
+                ? std::fabs((heights[index(ax, ay)] + heights[index(bx, by)]) * 0.5f - heights[index(mx, my)])
+                : triangleError(ax, ay, bx, by, cx, cy);
+            if (hasChildren) {
+                error = std::max(error, errors[index((ax + cx) / 2, (ay + cy) / 2)]);
+                error = std::max(error, errors[index((bx + cx) / 2, (by + cy) / 2)]);
+            }
+            float& stored = errors[index(mx, my)];
+            stored = std::max(stored, error);
+        }
+    };
+
+    // Walks the triangle tree from the two halves of the grid, splitting wherever the
+    // error is above the bound
+    class Extractor {
+    public:
+        Extractor(const float* heights, int size, const ErrorGrid& errors, float threshold,
+                  const TerrainMesh::Options& options,
+                  std::vector<TerrainMesh::Vertex>& vertices, std::vector<std::uint32_t>& indices)
+            : heights(heights)
+            , size(size)
+            , errors(errors)
+            , threshold(threshold)
+            , options(options)
+            , vertices(vertices)
+            , indices(indices)
+            , vertexIndices(static_cast<std::size_t>(size) * size, NoVertex)
+        {
+        }
+
+        void run() {
+            int tileSize = size - 1;
+            triangle(0, 0, tileSize, tileSize, tileSize, 0);
+            triangle(tileSize, tileSize, 0, 0, 0, tileSize);
+        }
+
+    private:
+        static const std::uint32_t NoVertex = std::numeric_limits<std::uint32_t>::max();
+
+        const float* heights;
+        int size;
+        const ErrorGrid& errors;
+        float threshold;
+        const TerrainMesh::Options& options;
+        std::vector<TerrainMesh::Vertex>& vertices;
+        std::vector<std::uint32_t>& indices;
+        std::vector<std::uint32_t> vertexIndices;
+
+        float height(int x, int y) const {
+            return heights[static_cast<std::size_t>(y) * size + x];
+        }
+
+        void triangle(int ax, int ay, int bx, int by, int cx, int cy) {
+            int mx = (ax + bx) / 2;
+            int my = (ay + by) / 2;
+            if (std::abs(ax - cx) + std::abs(ay - cy) > 1 && errors.at(mx, my) > threshold) {
+                triangle(cx, cy, ax, ay, mx, my);
+                triangle(bx, by, cx, cy, mx, my);
+                return;
+            }
+
+            // Counter-clockwise seen from above, with z growing along the rows
+            if ((by - ay) * (cx - ax) - (bx - ax) * (cy - ay) < 0) {
+                std::swap(bx, cx);
+                std::swap(by, cy);
+            }
+            indices.push_back(vertex(ax, ay));
+            indices.push_back(vertex(bx, by));
+            indices.push_back(vertex(cx, cy));
+        }
+
+        std::uint32_t vertex(int x, int y) {
+            std::uint32_t& index = vertexIndices[static_cast<std::size_t>(y) * size + x];
+            if (index != NoVertex) {
+                return index;
+            }
+
+            // Normal from central differences of the heightmap, one-sided on the border
+            int x0 = std::max(x - 1, 0);
+            int x1 = std::min(x + 1, size - 1);
+            int y0 = std::max(y - 1, 0);
+            int y1 = std::min(y + 1, size - 1);
+            float slopeX = (height(x1, y) - height(x0, y)) * options.heightScale / ((x1 - x0) * options.cellSize);
+            float slopeZ = (height(x, y1) - height(x, y0)) * options.heightScale / ((y1 - y0) * options.cellSize);
+            float inverseLength = 1.0f / std::sqrt(slopeX * slopeX + slopeZ * slopeZ + 1.0f);
+
+            TerrainMesh::Vertex v;
+            v.x = x * options.cellSize;
+            v.y = height(x, y) * options.heightScale;
+            v.z = y * options.cellSize;
+            v.nx = -slopeX * inverseLength;
+            v.ny = inverseLength;
+            v.nz = -slopeZ * inverseLength;
+
+            index = static_cast<std::uint32_t>(vertices.size());
+            vertices.push_back(v);
+            return index;
+        }
+    };
+
+    void putLittleEndian32(std::vector<std::uint8_t>& out, std::uint32_t value) {
+        out.push_back(static_cast<std::uint8_t>(value));
+        out.push_back(static_cast<std::uint8_t>(value >> 8));
+        out.push_back(static_cast<std::uint8_t>(value >> 16));
+        out.push_back(static_cast<std::uint8_t>(value >> 24));
+    }
+
+    void putFloat(std::vector<std::uint8_t>& out, float value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putLittleEndian32(out, bits);
+    }
+}
+
+TerrainMesh TerrainMesh::build(const float* heights, unsigned int gridSize, const Options& options) {
+    unsigned int tileSize = gridSize - 1;
+    if (gridSize < 3 || (tileSize & (tileSize - 1)) != 0) {
+        throw std::runtime_error("Mesh grid size must be a power of two plus one, got " + std::to_string(gridSize));
+    }
+    if (!(options.cellSize > 0.0f) || !(options.heightScale > 0.0f)) {
+        throw std::runtime_error("Mesh cell size and height scale must be positive");
+    }
+
+    const int size = static_cast<int>(gridSize);
+    ErrorGrid errors(heights, size);
+
+    // Errors are stored in heightmap units, the options are in world units
+    float threshold = std::max(0.0f, options.maxError / options.heightScale);
+    if (options.maxTriangles > 0) {
+        std::size_t budget = std::max<std::size_t>(options.maxTriangles, 2);
+        if (errors.countTriangles(threshold) > budget) {
+            // The triangle count only shrinks as the bound grows, and no split is left
+            // at the largest error
+            float low = threshold;
+            float high = errors.getMaxError();
+            for (int step = 0; step < BudgetSearchSteps; ++step) {
+                float middle = low + (high - low) * 0.5f;
+                if (errors.countTriangles(middle) <= budget) {
+                    high = middle;
+                } else {
+                    low = middle;
+                }
+            }
+            threshold = high;
+        }
+    }
+
+    TerrainMesh mesh;
+    mesh.maxError = threshold * options.heightScale;
+    Extractor extractor(heights, size, errors, threshold, options, mesh.vertices, mesh.indices);
+    extractor.run();
+    return mesh;
+}
+
+unsigned int TerrainMesh::gridSizeFor(unsigned int width, unsigned int height) {
+    unsigned int tileSize = 2;
+    while (tileSize < std::max(width, height)) {
+        tileSize *= 2;
+    }
+    return tileSize + 1;
+}
+
+std::vector<std::uint8_t> TerrainMesh::encodeGlb() const {
+    const std::size_t vertexBytes = vertices.size() * sizeof(float) * 6;
+    const std::size_t indexBytes = indices.size() * sizeof(std::uint32_t);
+
+    // Accessors of positions need their bounds
+    float minimum[3] = { vertices[0].x, vertices[0].y, vertices[0].z };
+    float maximum[3] = { vertices[0].x, vertices[0].y, vertices[0].z };
+    for (const Vertex& v : vertices) {
+        const float position[3] = { v.x, v.y, v.z };
+        for (int i = 0; i < 3; ++i) {
+            minimum[i] = std::min(minimum[i], position[i]);
+            maximum[i] = std::max(maximum[i], position[i]);
+        }
+    }
+
+    // Nine significant digits read back as the same float
+    std::ostringstream json;
+    json << std::setprecision(9)
+         << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"Procedural Island Generator\"},"
+         << "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+         << "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2,\"mode\":4}]}],"
+         << "\"buffers\":[{\"byteLength\":" << vertexBytes + indexBytes << "}],"
+         << "\"bufferViews\":["
+         << "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" << vertexBytes << ",\"byteStride\":24,\"target\":34962},"
+         << "{\"buffer\":0,\"byteOffset\":" << vertexBytes << ",\"byteLength\":" << indexBytes << ",\"target\":34963}],"
+         << "\"accessors\":["
+         << "{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":" << vertices.size() << ",\"type\":\"VEC3\","
+         << "\"min\":[" << minimum[0] << "," << minimum[1] << "," << minimum[2] << "],"
+         << "\"max\":[" << maximum[0] << "," << maximum[1] << "," << maximum[2] << "]},"
+         << "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":" << vertices.size() << ",\"type\":\"VEC3\"},"
+         << "{\"bufferView\":1,\"byteOffset\":0,\"componentType\":5125,\"count\":" << indices.size() << ",\"type\":\"SCALAR\"}]}";
+
+    // Chunks are 4-byte aligned, the JSON one is padded with spaces
+    std::string text = json.str();
+    text.append((4 - text.size() % 4) % 4, ' ');
+
+    std::vector<std::uint8_t> out;
+    out.reserve(12 + 8 + text.size() + 8 + vertexBytes + indexBytes);
+    putLittleEndian32(out, GlbMagic);
+    putLittleEndian32(out, GlbVersion);
+    putLittleEndian32(out, static_cast<std::uint32_t>(12 + 8 + text.size() + 8 + vertexBytes + indexBytes));
+
+    putLittleEndian32(out, static_cast<std::uint32_t>(text.size()));
+    putLittleEndian32(out, GlbJsonChunk);
+    out.insert(out.end(), text.begin(), text.end());
+
+    putLittleEndian32(out, static_cast<std::uint32_t>(vertexBytes + indexBytes));
+    putLittleEndian32(out, GlbBinaryChunk);
+    for (const Vertex& v : vertices) {
+        putFloat(out, v.x);
+        putFloat(out, v.y);
+        putFloat(out, v.z);
+        putFloat(out, v.nx);
+        putFloat(out, v.ny);
+        putFloat(out, v.nz);
+    }
+    for (std::uint32_t index : indices) {
+        putLittleEndian32(out, index);
+    }
+    return out;
+}
+
+void TerrainMesh::write(const std::string& filename) const {
+    if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".obj") == 0) {
+        writeObj(filename);
+        return;
+    }
+
+    std::vector<std::uint8_t> bytes = encodeGlb();
+    std::ofstream file(filename, std::ios::binary);
+    if (!file || !file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()))) {
+        throw std::runtime_error("Failed to write mesh: " + filename);
+    }
+}
+
+void TerrainMesh::writeObj(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Failed to create mesh: " + filename);
+    }
+
+    file << "# Procedural Island Generator, " << vertices.size() << " vertices, "
+         << getTriangleCount() << " triangles\n" << std::setprecision(7);
+    for (const Vertex& v : vertices) {
+        file << "v " << v.x << ' ' << v.y << ' ' << v.z << '\n';
+    }
+    for (const Vertex& v : vertices) {
+        file << "vn " << v.nx << ' ' << v.ny << ' ' << v.nz << '\n';
+    }
+
+    // OBJ indices start at one
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        file << 'f';
+        for (std::size_t corner = 0; corner < 3; ++corner) {
+            std::uint32_t index = indices[i + corner] + 1;
+            file << ' ' << index << "//" << index;
+        }
+        file << '\n';
+    }
+
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write mesh: " + filename);
+    }
+}
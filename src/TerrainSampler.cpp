@@ -0,0 +1,708 @@
+#include "TerrainSampler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    struct IslandCenter {
+        float x, y;
+        float influence;
+        float size;
+    };
+
+    // Define multiple island centers with better distribution
+    const IslandCenter centers[] = {
+        {0.5f, 0.5f, 0.9f, 1.0f},      // Main island
+        {0.25f, 0.3f, 0.7f, 0.8f},     // Left island
+        {0.75f, 0.4f, 0.6f, 0.7f},     // Right island
+        {0.35f, 0.7f, 0.5f, 0.6f},     // Bottom-left island
+        {0.65f, 0.65f, 0.4f, 0.5f}     // Top-right island
+    };
+    
+    // Colors of the climate-only biomes, in TerrainType order from Tundra on
+    const TerrainSampler::Color biomeColors[] = {
+        {168, 176, 150, 255},   // Tundra
+        {60, 100, 70, 255},     // Taiga
+        {150, 160, 90, 255},    // Shrubland
+        {20, 90, 50, 255},      // Temperate rainforest
+        {222, 196, 120, 255},   // Desert
+        {177, 170, 80, 255},    // Savanna
+        {10, 110, 30, 255}      // Tropical rainforest
+    };
+    
+    // Stretches the climate noise, which rarely leaves [-0.3, 0.3], over the whole [0, 1] range
+    const float ClimateContrast = 1.6f;
+    
+    // Sum of the octave amplitudes, accumulated in the same order as in fbm()
+    float octaveWeight(int octaves, float persistence) {
+        float weight = 0.0f;
+        float amplitude = 1.0f;
+        for (int i = 0; i < octaves; ++i) {
+            weight += amplitude;
+            amplitude *= persistence;
+        }
+        return weight;
+    }
+    
+    // Resolution of the Whittaker lookup table along temperature and moisture
+    const int WhittakerSize = 16;
+    
+    // Whittaker diagram reduced to the biomes the generator knows, temperature and
+    // moisture both run from 0 (cold, dry) to 1 (hot, wet)
+    TerrainSampler::TerrainType classifyClimate(float moisture, float temperature) {
+        using TerrainType = TerrainSampler::TerrainType;
+        if (temperature < 0.2f) {
+            return TerrainType::Tundra;
+        }
+        if (temperature < 0.4f) {
+            return moisture < 0.3f ? TerrainType::Shrubland : TerrainType::Taiga;
+        }
+        if (temperature < 0.7f) {
+            if (moisture < 0.15f) return TerrainType::Desert;
+            if (moisture < 0.4f) return TerrainType::Grass;
+            if (moisture < 0.55f) return TerrainType::Shrubland;
+            if (moisture < 0.8f) return TerrainType::Forest;
+            return TerrainType::TemperateRainforest;
+        }
+        if (moisture < 0.3f) return TerrainType::Desert;
+        if (moisture < 0.6f) return TerrainType::Savanna;
+        return TerrainType::TropicalRainforest;
+    }
+    
+    // Rows by temperature, columns by moisture, sampled at the cell centers
+    const std::array<TerrainSampler::TerrainType, WhittakerSize * WhittakerSize>& whittakerTable() {
+        static const std::array<TerrainSampler::TerrainType, WhittakerSize * WhittakerSize> table = [] {
+            std::array<TerrainSampler::TerrainType, WhittakerSize * WhittakerSize> cells{};
+            for (int t = 0; t < WhittakerSize; ++t) {
+                for (int m = 0; m < WhittakerSize; ++m) {
+                    cells[t * WhittakerSize + m] = classifyClimate((m + 0.5f) / WhittakerSize, (t + 0.5f) / WhittakerSize);
+                }
+            }
+            return cells;
+        }();
+        return table;
+    }
+}
+
+TerrainSampler::TerrainSampler()
+    : seaLevel(0.500f)
+    , beachSize(0.030f)
+    , mountainLevel(0.610f)
+    , snowLevel(0.700f)
+    , boundedEvaluation(true)
+{
+}
+
+TerrainSampler::Lighting TerrainSampler::Lighting::fromAngles(float azimuth, float elevation, float relief) {
+    const float degreesToRadians = 3.14159265f / 180.0f;
+    float a = azimuth * degreesToRadians;
+    float e = elevation * degreesToRadians;
+    
+    Lighting lighting;
+    lighting.x = std::cos(e) * std::sin(a);
+    lighting.y = -std::cos(e) * std::cos(a);
+    lighting.z = std::sin(e);
+    lighting.relief = relief;
+    lighting.ambient = 0.3f;
+    return lighting;
+}
+
+float TerrainSampler::sampleHeight(const NoiseGenerator& noiseGen, float nx, float ny,
+                                   float scale, int octaves, float persistence) const {
+    float mask = islandMask(nx, ny, nullptr, nullptr);
+    
+    // Away from every island the height is zero whatever the noise
+    if (mask == 0.0f && boundedEvaluation) {
+        return 0.0f;
+    }
+    
+    // Get base noise value first
+    float noiseValue = noiseGen.fbm(nx * scale, ny * scale, octaves, persistence);
+    noiseValue = (noiseValue + 1.0f) * 0.5f; // Normalize to [0,1]
+    
+    return islandHeight(noiseValue, mask);
+}
+
+float TerrainSampler::islandHeight(float noiseValue, float mask) const {
+    // Combine noise and gradient with better blending
+    float finalHeight = noiseValue * mask;
+    
+    // Add some variation to water depth
+    if (finalHeight < seaLevel) {
+        finalHeight *= 0.8f + 0.2f * noiseValue;
+    }
+    
+    return finalHeight;
+}
+
+TerrainSampler::HeightSample TerrainSampler::sampleHeightWithDerivatives(const NoiseGenerator& noiseGen, float nx, float ny,
+                                                                         float scale, int octaves, float persistence) const {
+    float maskDx, maskDy;
+    float mask = islandMask(nx, ny, &maskDx, &maskDy);
+    
+    // Height and slope are both zero where the mask is, the slope of the mask included
+    if (mask == 0.0f && boundedEvaluation) {
+        return HeightSample{0.0f, 0.0f, 0.0f};
+    }
+    
+    return islandHeight(noiseGen.fbmWithDerivatives(nx * scale, ny * scale, octaves, persistence),
+                        scale, mask, maskDx, maskDy);
+}
+
+TerrainSampler::HeightSample TerrainSampler::islandHeight(const NoiseGenerator::Sample& noise, float scale,
+                                                          float mask, float maskDx, float maskDy) const {
+    float noiseValue = (noise.value + 1.0f) * 0.5f;
+    float noiseDx = noise.dx * 0.5f * scale;
+    float noiseDy = noise.dy * 0.5f * scale;
+    
+    // Product rule on noise * mask
+    HeightSample sample;
+    sample.height = noiseValue * mask;
+    sample.dx = noiseDx * mask + noiseValue * maskDx;
+    sample.dy = noiseDy * mask + noiseValue * maskDy;
+    
+    // Same water depth variation as sampleHeight()
+    if (sample.height < seaLevel) {
+        float factor = 0.8f + 0.2f * noiseValue;
+        sample.dx = sample.dx * factor + sample.height * 0.2f * noiseDx;
+        sample.dy = sample.dy * factor + sample.height * 0.2f * noiseDy;
+        sample.height *= factor;
+    }
+    
+    return sample;
+}
+
+TerrainSampler::Color TerrainSampler::sampleColor(const NoiseGenerator& noiseGen, float nx, float ny,
+                                                  float scale, int octaves, float persistence) const {
+    float height = sampleHeight(noiseGen, nx, ny, scale, octaves, persistence);
+    if (!climate.enabled) {
+        return getTerrainColor(height);
+    }
+    return getPalette()[samplePaletteIndex(moistureGenerator(noiseGen), temperatureGenerator(noiseGen), nx, ny, height)];
+}
+
+TerrainSampler::Color TerrainSampler::sampleShadedColor(const NoiseGenerator& noiseGen, float nx, float ny,
+                                                        float scale, int octaves, float persistence,
+                                                        const Lighting& lighting) const {
+    HeightSample sample = sampleHeightWithDerivatives(noiseGen, nx, ny, scale, octaves, persistence);
+    if (!climate.enabled) {
+        return getShadedColor(sample, lighting);
+    }
+    std::uint8_t index = samplePaletteIndex(moistureGenerator(noiseGen), temperatureGenerator(noiseGen), nx, ny, sample.height);
+    return shade(getPalette()[index], sample, lighting);
+}
+
+TerrainSampler::Color TerrainSampler::sampleColor(const NoiseGenerator& noiseGen, double nx, double ny,
+                                                  float scale, int octaves, float persistence) const {
+    float fx = static_cast<float>(nx);
+    float fy = static_cast<float>(ny);
+    float mask = islandMask(fx, fy, nullptr, nullptr);
+    float height = 0.0f;
+    if (mask != 0.0f || !boundedEvaluation) {
+        float noiseValue = noiseGen.fbm(nx * scale, ny * scale, octaves, persistence);
+        height = islandHeight((noiseValue + 1.0f) * 0.5f, mask);
+    }
+    if (!climate.enabled) {
+        return getTerrainColor(height);
+    }
+    return getPalette()[samplePaletteIndex(moistureGenerator(noiseGen), temperatureGenerator(noiseGen), fx, fy, height)];
+}
+
+TerrainSampler::Color TerrainSampler::sampleShadedColor(const NoiseGenerator& noiseGen, double nx, double ny,
+                                                        float scale, int octaves, float persistence,
+                                                        const Lighting& lighting) const {
+    float fx = static_cast<float>(nx);
+    float fy = static_cast<float>(ny);
+    float maskDx, maskDy;
+    float mask = islandMask(fx, fy, &maskDx, &maskDy);
+    HeightSample sample{0.0f, 0.0f, 0.0f};
+    if (mask != 0.0f || !boundedEvaluation) {
+        sample = islandHeight(noiseGen.fbmWithDerivatives(nx * scale, ny * scale, octaves, persistence),
+                              scale, mask, maskDx, maskDy);
+    }
+    if (!climate.enabled) {
+        return getShadedColor(sample, lighting);
+    }
+    std::uint8_t index = samplePaletteIndex(moistureGenerator(noiseGen), temperatureGenerator(noiseGen), fx, fy, sample.height);
+    return shade(getPalette()[index], sample, lighting);
+}
+
+float TerrainSampler::sampleMoisture(const NoiseGenerator& noiseGen, float nx, float ny) const {
+    return climateField(moistureGenerator(noiseGen), nx, ny);
+}
+
+float TerrainSampler::sampleTemperature(const NoiseGenerator& noiseGen, float nx, float ny, float height) const {
+    float temperature = climateField(temperatureGenerator(noiseGen), nx, ny);
+    return std::max(0.0f, temperature - climate.lapseRate * std::max(0.0f, height - seaLevel));
+}
+
+float TerrainSampler::climateField(const NoiseGenerator& fieldGen, float nx, float ny) const {
+    float value = fieldGen.fbm(nx * climate.scale, ny * climate.scale, climate.octaves, 0.5f);
+    return std::min(1.0f, std::max(0.0f, 0.5f + value * ClimateContrast));
+}
+
+NoiseGenerator TerrainSampler::moistureGenerator(const NoiseGenerator& noiseGen) const {
+    NoiseGenerator fieldGen;
+    fieldGen.setSeed(noiseGen.getSeed() + climate.moistureSeedOffset);
+    return fieldGen;
+}
+
+NoiseGenerator TerrainSampler::temperatureGenerator(const NoiseGenerator& noiseGen) const {
+    NoiseGenerator fieldGen;
+    fieldGen.setSeed(noiseGen.getSeed() + climate.temperatureSeedOffset);
+    return fieldGen;
+}
+
+bool TerrainSampler::isLowland(float height) const {
+    return height >= seaLevel + beachSize && height < mountainLevel;
+}
+
+std::uint8_t TerrainSampler::samplePaletteIndex(const NoiseGenerator& moistureGen, const NoiseGenerator& temperatureGen,
+                                                float nx, float ny, float height) const {
+    // Water, beaches and mountains don't depend on the climate, which skips both
+    // fields for most of the map
+    if (!climate.enabled || !isLowland(height)) {
+        return getPaletteIndex(height);
+    }
+    float moisture = climateField(moistureGen, nx, ny);
+    float temperature = climateField(temperatureGen, nx, ny);
+    temperature = std::max(0.0f, temperature - climate.lapseRate * (height - seaLevel));
+    return getBiomePaletteIndex(height, moisture, temperature);
+}
+
+std::uint8_t TerrainSampler::sampleBoundedPaletteIndex(const NoiseGenerator& noiseGen, float nx, float ny,
+                                                       float scale, int octaves, float persistence, int* octavesUsed) const {
+    return evaluatePaletteIndex(noiseGen, moistureGenerator(noiseGen), temperatureGenerator(noiseGen), nx, ny,
+                                scale, octaves, persistence, octaveWeight(octaves, persistence), octavesUsed);
+}
+
+std::uint8_t TerrainSampler::evaluatePaletteIndex(const NoiseGenerator& noiseGen, const NoiseGenerator& moistureGen,
+                                                  const NoiseGenerator& temperatureGen, float nx, float ny,
+                                                  float scale, int octaves, float persistence, float weight,
+                                                  int* octavesUsed) const {
+    if (!boundedEvaluation || octaves < 1 || persistence <= 0.0f) {
+        if (octavesUsed) {
+            *octavesUsed = octaves;
+        }
+        return samplePaletteIndex(moistureGen, temperatureGen, nx, ny, sampleHeight(noiseGen, nx, ny, scale, octaves, persistence));
+    }
+    
+    float mask = islandMask(nx, ny, nullptr, nullptr);
+    if (mask == 0.0f) {
+        if (octavesUsed) {
+            *octavesUsed = 0;
+        }
+        return samplePaletteIndex(moistureGen, temperatureGen, nx, ny, 0.0f);
+    }
+    
+    // Margin for rounding in the sums, far more than float addition of a few octaves loses
+    const float slack = weight * 1.0e-5f;
+    NoiseGenerator::OctaveSum sum(noiseGen, nx * scale, ny * scale, persistence);
+    for (int i = 1; i < octaves; ++i) {
+        sum.addOctave();
+        
+        // The remaining octaves can move the sum by at most their weight times the noise
+        // bound. Height and palette index never decrease as the noise grows, so equal
+        // indices at both ends of the range fix the index of everything in between.
+        float spread = (weight - sum.getWeight()) * NoiseGenerator::MaxNoise + slack;
+        float low = std::max(0.0f, ((sum.getTotal() - spread) / weight + 1.0f) * 0.5f);
+        float high = std::min(1.0f, ((sum.getTotal() + spread) / weight + 1.0f) * 0.5f);
+        std::uint8_t index = getPaletteIndex(islandHeight(low, mask));
+        if (index != getPaletteIndex(islandHeight(high, mask))) {
+            continue;
+        }
+        
+        // Lowland biomes also depend on the exact height through the temperature
+        if (climate.enabled && index >= GrassPaletteIndex && index < MountainPaletteIndex) {
+            continue;
+        }
+        if (octavesUsed) {
+            *octavesUsed = i;
+        }
+        return index;
+    }
+    
+    sum.addOctave();
+    if (octavesUsed) {
+        *octavesUsed = octaves;
+    }
+    float noiseValue = (sum.getTotal() / sum.getWeight() + 1.0f) * 0.5f;
+    return samplePaletteIndex(moistureGen, temperatureGen, nx, ny, islandHeight(noiseValue, mask));
+}
+
+float TerrainSampler::sampleMask(float nx, float ny) const {
+    return islandMask(nx, ny, nullptr, nullptr);
+}
+
+float TerrainSampler::islandMask(float nx, float ny, float* slopeX, float* slopeY) const {
+    // Calculate combined gradient from all island centers
+    float maxGradient = 0.0f;
+    float maxSlopeX = 0.0f;
+    float maxSlopeY = 0.0f;
+    for (const auto& center : centers) {
+        float dx = nx - center.x;
+        float dy = ny - center.y;
+        float distance = std::sqrt(dx * dx + dy * dy);
+        float distanceFromCenter = distance / center.size;
+        
+        // Smoother falloff using cubic function
+        float gradient = 0.0f;
+        if (distanceFromCenter < 1.0f) {
+            gradient = 1.0f - (3.0f * std::pow(distanceFromCenter, 2.0f) - 2.0f * std::pow(distanceFromCenter, 3.0f));
+            gradient *= center.influence;
+        }
+        
+        if (gradient > maxGradient) {
+            maxGradient = gradient;
+            if (slopeX && distance > 0.0f) {
+                // d/dd of 1 - 3d^2 + 2d^3 is 6d(d - 1), and dd/dx is dx / (distance * size)
+                float slope = center.influence * 6.0f * distanceFromCenter * (distanceFromCenter - 1.0f) / (distance * center.size);
+                maxSlopeX = slope * dx;
+                maxSlopeY = slope * dy;
+            }
+        }
+    }
+    
+    if (slopeX) {
+        *slopeX = maxSlopeX;
+        *slopeY = maxSlopeY;
+    }
+    return maxGradient;
+}
+
+TerrainSampler::Color TerrainSampler::getTerrainColor(float height) const {
+    if (height < seaLevel - beachSize) {
+        // Deep water
+        return Color{0, 0, 139, 255}; // Dark blue
+    }
+    else if (height < seaLevel) {
+        // Shallow water
+        return Color{0, 191, 255, 255}; // Deep sky blue
+    }
+    else if (height < seaLevel + beachSize) {
+        // Beach
+        return Color{238, 214, 175, 255}; // Sandy
+    }
+    else if (height < mountainLevel) {
+        // Grass/forest
+        float t = (height - (seaLevel + beachSize)) / (mountainLevel - (seaLevel + beachSize));
+        return Color{
+            static_cast<std::uint8_t>(34 + static_cast<int>(t * (85 - 34))),
+            static_cast<std::uint8_t>(139 + static_cast<int>(t * (107 - 139))),
+            static_cast<std::uint8_t>(34 + static_cast<int>(t * (47 - 34))),
+            255
+        };
+    }
+    else if (height < snowLevel) {
+        // Mountain
+        return Color{139, 137, 137, 255}; // Gray
+    }
+    else {
+        // Snow
+        return Color{255, 250, 250, 255}; // Snow white
+    }
+}
+
+TerrainSampler::TerrainType TerrainSampler::getTerrainType(float height) const {
+    return getPaletteTerrainType(getPaletteIndex(height));
+}
+
+std::uint8_t TerrainSampler::getPaletteIndex(float height) const {
+    if (height < seaLevel - beachSize) {
+        return DeepWaterPaletteIndex;
+    }
+    else if (height < seaLevel) {
+        return ShallowWaterPaletteIndex;
+    }
+    else if (height < seaLevel + beachSize) {
+        return BeachPaletteIndex;
+    }
+    else if (height < mountainLevel) {
+        // Along the grass gradient red and blue only grow and green only shrinks,
+        // so the summed channel offsets number the colors in order without gaps
+        Color color = getTerrainColor(height);
+        return static_cast<std::uint8_t>(GrassPaletteIndex + (color.r - 34) + (139 - color.g) + (color.b - 34));
+    }
+    else if (height < snowLevel) {
+        return MountainPaletteIndex;
+    }
+    else {
+        return SnowPaletteIndex;
+    }
+}
+
+std::uint8_t TerrainSampler::getBiomePaletteIndex(float height, float moisture, float temperature) const {
+    std::uint8_t index = getPaletteIndex(height);
+    if (!isLowland(height)) {
+        return index;
+    }
+    
+    // Grass and forest each keep half of the height gradient, so the palette
+    // still tells them apart
+    const int split = (GrassPaletteIndex + MountainPaletteIndex) / 2;
+    TerrainType biome = getWhittakerBiome(moisture, temperature);
+    if (biome == TerrainType::Grass) {
+        return static_cast<std::uint8_t>(GrassPaletteIndex + (index - GrassPaletteIndex) / 2);
+    }
+    if (biome == TerrainType::Forest) {
+        return static_cast<std::uint8_t>(split + (index - GrassPaletteIndex) / 2);
+    }
+    return static_cast<std::uint8_t>(BiomePaletteIndex + static_cast<int>(biome) - static_cast<int>(TerrainType::Tundra));
+}
+
+TerrainSampler::TerrainType TerrainSampler::getWhittakerBiome(float moisture, float temperature) {
+    int m = std::min(std::max(static_cast<int>(moisture * WhittakerSize), 0), WhittakerSize - 1);
+    int t = std::min(std::max(static_cast<int>(temperature * WhittakerSize), 0), WhittakerSize - 1);
+    return whittakerTable()[t * WhittakerSize + m];
+}
+
+const std::array<TerrainSampler::Color, TerrainSampler::PaletteSize>& TerrainSampler::getPalette() {
+    static const std::array<Color, PaletteSize> palette = [] {
+        std::array<Color, PaletteSize> colors{};
+        TerrainSampler sampler;
+        
+        colors[DeepWaterPaletteIndex] = sampler.getTerrainColor(0.0f);
+        colors[ShallowWaterPaletteIndex] = sampler.getTerrainColor(sampler.seaLevel - sampler.beachSize * 0.5f);
+        colors[BeachPaletteIndex] = sampler.getTerrainColor(sampler.seaLevel + sampler.beachSize * 0.5f);
+        colors[MountainPaletteIndex] = sampler.getTerrainColor(sampler.mountainLevel);
+        colors[SnowPaletteIndex] = sampler.getTerrainColor(sampler.snowLevel);
+        
+        // Sweep the grass band finely enough to hit every color of the gradient
+        const int steps = 1 << 16;
+        const float low = sampler.seaLevel + sampler.beachSize;
+        for (int i = 0; i < steps; ++i) {
+            float height = low + (sampler.mountainLevel - low) * i / steps;
+            colors[sampler.getPaletteIndex(height)] = sampler.getTerrainColor(height);
+        }
+        
+        for (std::size_t i = 0; i < PaletteSize - BiomePaletteIndex; ++i) {
+            colors[BiomePaletteIndex + i] = biomeColors[i];
+        }
+        return colors;
+    }();
+    return palette;
+}
+
+TerrainSampler::TerrainType TerrainSampler::getPaletteTerrainType(std::uint8_t index) {
+    if (index == DeepWaterPaletteIndex) return TerrainType::DeepWater;
+    if (index == ShallowWaterPaletteIndex) return TerrainType::ShallowWater;
+    if (index == BeachPaletteIndex) return TerrainType::Beach;
+    if (index == SnowPaletteIndex) return TerrainType::Snow;
+    if (index == MountainPaletteIndex) return TerrainType::Mountain;
+    if (index >= BiomePaletteIndex && index < PaletteSize) {
+        return static_cast<TerrainType>(static_cast<int>(TerrainType::Tundra) + index - BiomePaletteIndex);
+    }
+    
+    // The darker half of the grass gradient is forest
+    return index < (GrassPaletteIndex + MountainPaletteIndex) / 2 ? TerrainType::Grass : TerrainType::Forest;
+}
+
+TerrainSampler::Color TerrainSampler::getShadedColor(const HeightSample& sample, const Lighting& lighting) const {
+    return shade(getTerrainColor(sample.height), sample, lighting);
+}
+
+TerrainSampler::Color TerrainSampler::shade(Color color, const HeightSample& sample, const Lighting& lighting) const {
+    if (sample.height < seaLevel) {
+        return color;
+    }
+    
+    // Lambert term relative to flat ground, so level terrain keeps its color
+    float nx = -lighting.relief * sample.dx;
+    float ny = -lighting.relief * sample.dy;
+    float length = std::sqrt(nx * nx + ny * ny + 1.0f);
+    float diffuse = std::max(0.0f, (nx * lighting.x + ny * lighting.y + lighting.z) / length) / lighting.z;
+    float light = lighting.ambient + (1.0f - lighting.ambient) * diffuse;
+    
+    return Color{
+        static_cast<std::uint8_t>(std::min(255.0f, color.r * light)),
+        static_cast<std::uint8_t>(std::min(255.0f, color.g * light)),
+        static_cast<std::uint8_t>(std::min(255.0f, color.b * light)),
+        color.a
+    };
+}
+
+TerrainSampler::Color TerrainSampler::getNormalColor(const HeightSample& sample, const Lighting& lighting) const {
+    float nx = -lighting.relief * sample.dx;
+    float ny = -lighting.relief * sample.dy;
+    float inverseLength = 1.0f / std::sqrt(nx * nx + ny * ny + 1.0f);
+    
+    return Color{
+        static_cast<std::uint8_t>((nx * inverseLength * 0.5f + 0.5f) * 255.0f),
+        static_cast<std::uint8_t>((-ny * inverseLength * 0.5f + 0.5f) * 255.0f),
+        static_cast<std::uint8_t>((inverseLength * 0.5f + 0.5f) * 255.0f),
+        255
+    };
+}
+
+void TerrainSampler::generateHeights(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                                     unsigned int width, unsigned int height,
+                                     unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                                     float* heights, std::size_t stride) const {
+    for (unsigned int y = 0; y < rows; ++y) {
+        float ny = static_cast<float>(top + y) / height;
+        float* row = heights + y * stride;
+        for (unsigned int x = 0; x < columns; ++x) {
+            float nx = static_cast<float>(left + x) / width;
+            row[x] = sampleHeight(noiseGen, nx, ny, scale, octaves, persistence);
+        }
+    }
+}
+
+void TerrainSampler::generateColors(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                                    unsigned int width, unsigned int height,
+                                    unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                                    std::uint8_t* pixels, std::size_t stride) const {
+    // Climate fields are evaluated in the same loop as the height, only where needed
+    const NoiseGenerator moistureGen = moistureGenerator(noiseGen);
+    const NoiseGenerator temperatureGen = temperatureGenerator(noiseGen);
+    const std::array<Color, PaletteSize>& palette = getPalette();
+    const float weight = octaveWeight(octaves, persistence);
+    
+    for (unsigned int y = 0; y < rows; ++y) {
+        float ny = static_cast<float>(top + y) / height;
+        std::uint8_t* row = pixels + y * stride;
+        for (unsigned int x = 0; x < columns; ++x) {
+            float nx = static_cast<float>(left + x) / width;
+            Color color;
+            if (climate.enabled || boundedEvaluation) {
+                color = palette[evaluatePaletteIndex(noiseGen, moistureGen, temperatureGen, nx, ny,
+                                                     scale, octaves, persistence, weight, nullptr)];
+            } else {
+                color = getTerrainColor(sampleHeight(noiseGen, nx, ny, scale, octaves, persistence));
+            }
+            row[x * 4 + 0] = color.r;
+            row[x * 4 + 1] = color.g;
+            row[x * 4 + 2] = color.b;
+            row[x * 4 + 3] = color.a;
+        }
+    }
+}
+
+void TerrainSampler::generateIndices(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                                     unsigned int width, unsigned int height,
+                                     unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                                     std::uint8_t* indices, std::size_t stride) const {
+    const NoiseGenerator moistureGen = moistureGenerator(noiseGen);
+    const NoiseGenerator temperatureGen = temperatureGenerator(noiseGen);
+    const float weight = octaveWeight(octaves, persistence);
+    
+    for (unsigned int y = 0; y < rows; ++y) {
+        float ny = static_cast<float>(top + y) / height;
+        std::uint8_t* row = indices + y * stride;
+        for (unsigned int x = 0; x < columns; ++x) {
+            float nx = static_cast<float>(left + x) / width;
+            row[x] = evaluatePaletteIndex(noiseGen, moistureGen, temperatureGen, nx, ny,
+                                          scale, octaves, persistence, weight, nullptr);
+        }
+    }
+}
+
+void TerrainSampler::colorsFromNoise(const NoiseGenerator& noiseGen, const float* noise, const float* masks, std::size_t noiseStride,
+                                     unsigned int width, unsigned int height,
+                                     unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                                     std::uint8_t* pixels, std::size_t stride) const {
+    const NoiseGenerator moistureGen = moistureGenerator(noiseGen);
+    const NoiseGenerator temperatureGen = temperatureGenerator(noiseGen);
+    const std::array<Color, PaletteSize>& palette = getPalette();
+    
+    for (unsigned int y = 0; y < rows; ++y) {
+        float ny = static_cast<float>(top + y) / height;
+        const float* noiseRow = noise + y * noiseStride;
+        const float* maskRow = masks + y * noiseStride;
+        std::uint8_t* row = pixels + y * stride;
+        for (unsigned int x = 0; x < columns; ++x) {
+            float value = islandHeight((noiseRow[x] + 1.0f) * 0.5f, maskRow[x]);
+            Color color;
+            if (climate.enabled) {
+                float nx = static_cast<float>(left + x) / width;
+                color = palette[samplePaletteIndex(moistureGen, temperatureGen, nx, ny, value)];
+            } else {
+                color = getTerrainColor(value);
+            }
+            row[x * 4 + 0] = color.r;
+            row[x * 4 + 1] = color.g;
+            row[x * 4 + 2] = color.b;
+            row[x * 4 + 3] = color.a;
+        }
+    }
+}
+
+void TerrainSampler::indicesFromNoise(const NoiseGenerator& noiseGen, const float* noise, const float* masks, std::size_t noiseStride,
+                                      unsigned int width, unsigned int height,
+                                      unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                                      std::uint8_t* indices, std::size_t stride) const {
+    const NoiseGenerator moistureGen = moistureGenerator(noiseGen);
+    const NoiseGenerator temperatureGen = temperatureGenerator(noiseGen);
+    
+    for (unsigned int y = 0; y < rows; ++y) {
+        float ny = static_cast<float>(top + y) / height;
+        const float* noiseRow = noise + y * noiseStride;
+        const float* maskRow = masks + y * noiseStride;
+        std::uint8_t* row = indices + y * stride;
+        for (unsigned int x = 0; x < columns; ++x) {
+            float nx = static_cast<float>(left + x) / width;
+            float value = islandHeight((noiseRow[x] + 1.0f) * 0.5f, maskRow[x]);
+            row[x] = samplePaletteIndex(moistureGen, temperatureGen, nx, ny, value);
+        }
+    }
+}
+
+void TerrainSampler::generateShaded(const NoiseGenerator& noiseGen, float scale, int octaves, float persistence,
+                                    unsigned int width, unsigned int height,
+                                    unsigned int left, unsigned int top, unsigned int columns, unsigned int rows,
+                                    const Lighting& lighting,
+                                    std::uint8_t* pixels, std::size_t stride,
+                                    std::uint8_t* normals, std::size_t normalStride) const {
+    const NoiseGenerator moistureGen = moistureGenerator(noiseGen);
+    const NoiseGenerator temperatureGen = temperatureGenerator(noiseGen);
+    const std::array<Color, PaletteSize>& palette = getPalette();
+    
+    for (unsigned int y = 0; y < rows; ++y) {
+        float ny = static_cast<float>(top + y) / height;
+        std::uint8_t* row = pixels + y * stride;
+        std::uint8_t* normalRow = normals ? normals + y * normalStride : nullptr;
+        for (unsigned int x = 0; x < columns; ++x) {
+            float nx = static_cast<float>(left + x) / width;
+            HeightSample sample = sampleHeightWithDerivatives(noiseGen, nx, ny, scale, octaves, persistence);
+            
+            Color base = climate.enabled ? palette[samplePaletteIndex(moistureGen, temperatureGen, nx, ny, sample.height)]
+                                         : getTerrainColor(sample.height);
+            Color color = shade(base, sample, lighting);
+            row[x * 4 + 0] = color.r;
+            row[x * 4 + 1] = color.g;
+            row[x * 4 + 2] = color.b;
+            row[x * 4 + 3] = color.a;
+            
+            if (normalRow) {
+                Color normal = getNormalColor(sample, lighting);
+                normalRow[x * 4 + 0] = normal.r;
+                normalRow[x * 4 + 1] = normal.g;
+                normalRow[x * 4 + 2] = normal.b;
+                normalRow[x * 4 + 3] = normal.a;
+            }
+        }
+    }
+}
+
+void TerrainSampler::setSeaLevel(float level) {
+    seaLevel = level;
+}
+
+void TerrainSampler::setBeachSize(float size) {
+    beachSize = size;
+}
+
+void TerrainSampler::setMountainLevel(float level) {
+    mountainLevel = level;
+}
+
+void TerrainSampler::setSnowLevel(float level) {
+    snowLevel = level;
+}
+
+void TerrainSampler::setClimate(const ClimateSettings& settings) {
+    climate = settings;
+}
+
+void TerrainSampler::setBoundedEvaluation(bool enabled) {
+    boundedEvaluation = enabled;
+}
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "TileCache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+TileCache::TileCache(std::size_t maxTiles, unsigned int threadCount)
+    : maxTiles(maxTiles)
+    , frame(0)
+    , generation(0)
+    , currentLevel(0)
+    , currentOctaves(0)
+    , pendingTiles(0)
+    , staleTiles(false)
+    , stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&TileCache::workerLoop, this);
+    }
+}
+
+TileCache::~TileCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void TileCache::clear() {
+    staleTiles = !tiles.empty();
+    pendingTiles = 0;
+
+    // Tiles still being generated are dropped when they arrive
+    std::lock_guard<std::mutex> lock(mutex);
+    ++generation;
+    settings.reset();
+    requests.clear();
+    inFlight.clear();
+    finished.clear();
+}
+
+std::vector<TileCache::DrawItem> TileCache::update(const IslandGenerator& islandGen, const NoiseGenerator& noiseGen,
+                                                   float scale, int octaves, float persistence,
+                                                   double viewLeft, double viewTop, double viewRight, double viewBottom,
+                                                   double pixelsPerUnit, sf::Time budget) {
+    ++frame;
+
+    // Pick the first level whose tiles are at least as sharp as the screen
+    double exactLevel = std::log2(pixelsPerUnit / TileSize);
+    int level = std::max(0, std::min(MaxLevel, static_cast<int>(std::ceil(exactLevel))));
+    currentLevel = level;
+    currentOctaves = octavesForLevel(level, octaves);
+
+    // Workers generate every tile of a generation from the same copy of the parameters
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!settings) {
+            std::shared_ptr<Settings> next(new Settings());
+            next->region = islandGen.getRegionSettings();
+            next->noiseGen = noiseGen;
+            next->scale = scale;
+            next->octaves = octaves;
+            next->persistence = persistence;
+            next->octaveCache = islandGen.isOctaveCacheEnabled();
+            next->generation = generation;
+            settings = next;
+        }
+    }
+
+    upload(budget);
+
+    // Outdated tiles only bridge the time until the new whole world is there
+    TileKey root{0, 0, 0};
+    if (staleTiles && isCached(root)) {
+        for (auto it = tiles.begin(); it != tiles.end();) {
+            it = it->second->generation != generation ? tiles.erase(it) : std::next(it);
+        }
+        staleTiles = false;
+    }
+
+    // The whole world at the coarsest level is always requested first as the fallback
+    std::vector<TileKey> missing;
+    std::vector<DrawItem> items;
+
+    // Clamp the view to the world, nothing is generated outside of [0,1]
+    viewLeft = std::max(viewLeft, 0.0);
+    viewTop = std::max(viewTop, 0.0);
+    viewRight = std::min(viewRight, 1.0);
+    viewBottom = std::min(viewBottom, 1.0);
+    const bool visible = viewLeft < viewRight && viewTop < viewBottom;
+
+    const int tilesPerSide = 1 << level;
+    const double tileExtent = 1.0 / tilesPerSide;
+    const int x0 = visible ? static_cast<int>(viewLeft / tileExtent) : 0;
+    const int y0 = visible ? static_cast<int>(viewTop / tileExtent) : 0;
+    const int x1 = visible ? std::min(tilesPerSide - 1, static_cast<int>(viewRight / tileExtent)) : -1;
+    const int y1 = visible ? std::min(tilesPerSide - 1, static_cast<int>(viewBottom / tileExtent)) : -1;
+
+    // Find missing tiles, the ones closest to the view center go first
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            TileKey key{level, x, y};
+            if (!isCached(key) && level > 0) {
+                missing.push_back(key);
+            }
+        }
+    }
+
+    const double centerX = (viewLeft + viewRight) * 0.5 / tileExtent - 0.5;
+    const double centerY = (viewTop + viewBottom) * 0.5 / tileExtent - 0.5;
+    std::sort(missing.begin(), missing.end(), [&](const TileKey& a, const TileKey& b) {
+        double da = (a.x - centerX) * (a.x - centerX) + (a.y - centerY) * (a.y - centerY);
+        double db = (b.x - centerX) * (b.x - centerX) + (b.y - centerY) * (b.y - centerY);
+        return da < db;
+    });
+    if (!isCached(root)) {
+        missing.insert(missing.begin(), root);
+    }
+    pendingTiles = static_cast<int>(missing.size());
+
+    // Requests follow the view, tiles that scrolled away are never started
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.clear();
+        for (const TileKey& key : missing) {
+            if (inFlight.find(key) == inFlight.end()) {
+                requests.push_back(key);
+            }
+        }
+    }
+    condition.notify_all();
+
+    // Draw each visible tile, or the matching part of its closest cached ancestor
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            TileKey key{level, x, y};
+            TileKey found;
+            const Tile* tile = findCovering(key, found);
+            if (!tile) {
+                continue;
+            }
+
+            const int span = 1 << (key.level - found.level);
+            const float subX = static_cast<float>(x & (span - 1));
+            const float subY = static_cast<float>(y & (span - 1));
+
+            DrawItem item;
+            item.texture = &tile->texture;
+            item.u0 = subX / span;
+            item.v0 = subY / span;
+            item.u1 = (subX + 1.0f) / span;
+            item.v1 = (subY + 1.0f) / span;
+            item.left = x * tileExtent;
+            item.top = y * tileExtent;
+            item.right = (x + 1) * tileExtent;
+            item.bottom = (y + 1) * tileExtent;
+            items.push_back(item);
+        }
+    }
+
+    evict();
+    return items;
+}
+
+int TileCache::octavesForLevel(int level, int octaves) {
+    // Level 1 matches the original 512 pixel map, every level past it halves the pixel size
+    return std::min(MaxOctaves, octaves + std::max(0, level - 1));
+}
+
+void TileCache::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        condition.wait(lock, [this] { return stopping || (settings && !requests.empty()); });
+        if (stopping) {
+            return;
+        }
+
+        TileKey key = requests.front();
+        requests.erase(requests.begin());
+        inFlight.insert(key);
+        std::shared_ptr<const Settings> current = settings;
+
+        // A cached level is built as a whole, its other tiles are taken along
+        const bool wholeLevel = key.level < CachedLevels && current->octaveCache && !current->region.shading;
+        if (wholeLevel) {
+            const int tilesPerSide = 1 << key.level;
+            for (int y = 0; y < tilesPerSide; ++y) {
+                for (int x = 0; x < tilesPerSide; ++x) {
+                    inFlight.insert(TileKey{key.level, x, y});
+                }
+            }
+            requests.erase(std::remove_if(requests.begin(), requests.end(),
+                                          [&](const TileKey& request) { return request.level == key.level; }),
+                           requests.end());
+        }
+        lock.unlock();
+
+        std::vector<Finished> done;
+        if (wholeLevel) {
+            generateLevel(*current, key.level, done);
+        } else {
+            done.emplace_back();
+            done.back().key = key;
+            generateTile(*current, done.back());
+            if (key.level < CachedLevels && !current->octaveCache) {
+                std::lock_guard<std::mutex> levelLock(levelMutexes[key.level]);
+                levelCaches[key.level].clear();
+            }
+        }
+
+        // The keys stay in flight until upload turns them into textures, so they aren't requested again
+        lock.lock();
+        if (current->generation == generation) {
+            finished.insert(finished.end(), std::make_move_iterator(done.begin()), std::make_move_iterator(done.end()));
+        }
+    }
+}
+
+void TileCache::generateTile(const Settings& current, Finished& done) {
+    done.generation = current.generation;
+    done.pixels.resize(static_cast<std::size_t>(TileSize) * TileSize * 4);
+    const double extent = 1.0 / (1 << done.key.level);
+    IslandGenerator::generateRegion(current.region, current.noiseGen, current.scale,
+                                    octavesForLevel(done.key.level, current.octaves), current.persistence,
+                                    done.key.x * extent, done.key.y * extent, extent, TileSize, done.pixels.data());
+}
+
+void TileCache::generateLevel(const Settings& current, int level, std::vector<Finished>& done) {
+    // The whole level as one map, level 1 is the original 512 pixel map
+    const int tilesPerSide = 1 << level;
+    const unsigned int size = TileSize << level;
+    const std::size_t stride = static_cast<std::size_t>(size) * 4;
+    std::vector<std::uint8_t> pixels(stride * size);
+    {
+        std::lock_guard<std::mutex> levelLock(levelMutexes[level]);
+        levelCaches[level].generateColors(current.region.terrain, current.noiseGen, current.scale,
+                                          octavesForLevel(level, current.octaves), current.persistence,
+                                          size, size, pixels.data(), stride);
+    }
+
+    // Cut into tiles
+    const std::size_t tileStride = static_cast<std::size_t>(TileSize) * 4;
+    for (int y = 0; y < tilesPerSide; ++y) {
+        for (int x = 0; x < tilesPerSide; ++x) {
+            Finished tile;
+            tile.key = TileKey{level, x, y};
+            tile.generation = current.generation;
+            tile.pixels.resize(tileStride * TileSize);
+            for (unsigned int row = 0; row < TileSize; ++row) {
+                const std::uint8_t* source = pixels.data() + (static_cast<std::size_t>(y) * TileSize + row) * stride +
+                                             x * tileStride;
+                std::copy(source, source + tileStride, tile.pixels.data() + row * tileStride);
+            }
+            done.push_back(std::move(tile));
+        }
+    }
+}
+
+void TileCache::upload(sf::Time budget) {
+    std::vector<Finished> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(finished);
+    }
+
+    // At least one tile per frame, the rest waits for the next one once the budget is gone
+    sf::Clock clock;
+    std::size_t uploaded = 0;
+    while (uploaded < ready.size() && (uploaded == 0 || clock.getElapsedTime() < budget)) {
+        Finished& done = ready[uploaded++];
+        if (done.generation != generation) {
+            continue;
+        }
+
+        std::unique_ptr<Tile> tile(new Tile());
+        if (!tile->texture.create(TileSize, TileSize)) {
+            throw std::runtime_error("Failed to create tile texture");
+        }
+        tile->texture.update(done.pixels.data());
+        tile->lastUsed = frame;
+        tile->generation = generation;
+        tiles[done.key] = std::move(tile);
+    }
+
+    // Uploaded keys leave inFlight, outdated ones already left it in clear and may be in flight again
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t i = 0; i < uploaded; ++i) {
+        if (ready[i].generation == generation) {
+            inFlight.erase(ready[i].key);
+        }
+    }
+    if (uploaded < ready.size()) {
+        finished.insert(finished.begin(), std::make_move_iterator(ready.begin() + static_cast<std::ptrdiff_t>(uploaded)),
+                        std::make_move_iterator(ready.end()));
+    }
+}
+
+bool TileCache::isCached(const TileKey& key) const {
+    auto it = tiles.find(key);
+    return it != tiles.end() && it->second->generation == generation;
+}
+
+const TileCache::Tile* TileCache::findCovering(const TileKey& key, TileKey& found) {
+    const Tile* tile = findCovering(key, found, true);
+    return tile ? tile : findCovering(key, found, false);
+}
+
+const TileCache::Tile* TileCache::findCovering(const TileKey& key, TileKey& found, bool current) {
+    for (int up = 0; up <= key.level; ++up) {
+        TileKey candidate{key.level - up, key.x >> up, key.y >> up};
+        auto it = tiles.find(candidate);
+        if (it != tiles.end() && (!current || it->second->generation == generation)) {
+            it->second->lastUsed = frame;
+            found = candidate;
+            return it->second.get();
+        }
+    }
+    return nullptr;
+}
+
+void TileCache::evict() {
+    if (tiles.size() <= maxTiles) {
+        return;
+    }
+
+    // Only tiles that were not drawn this frame are candidates, outdated ones first,
+    // the root tile is never dropped
+    std::vector<std::pair<std::pair<bool, unsigned int>, TileKey>> candidates;
+    for (const auto& entry : tiles) {
+        if (entry.second->lastUsed != frame && entry.first.level > 0) {
+            bool current = entry.second->generation == generation;
+            candidates.push_back({{current, entry.second->lastUsed}, entry.first});
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const std::pair<std::pair<bool, unsigned int>, TileKey>& a,
+           const std::pair<std::pair<bool, unsigned int>, TileKey>& b) {
+            return a.first < b.first;
+        });
+
+    for (const auto& candidate : candidates) {
+        if (tiles.size() <= maxTiles) {
+            break;
+        }
+        tiles.erase(candidate.second);
+    }
+}
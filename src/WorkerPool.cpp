@@ -0,0 +1,99 @@
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+    : taskFunction(nullptr)
+    , taskContext(nullptr)
+    , taskCount(0)
+    , nextTask(0)
+    , busyWorkers(0)
+    , generation(0)
+    , stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // The calling thread takes part in every run, so one thread fewer is started
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+unsigned int WorkerPool::getThreadCount() const {
+    return static_cast<unsigned int>(threads.size()) + 1;
+}
+
+void WorkerPool::run(int count, TaskFunction function, const void* context) {
+    if (count <= 0) {
+        return;
+    }
+
+    // Only one run at a time, concurrent callers queue up here
+    std::lock_guard<std::mutex> runLock(runMutex);
+
+    if (threads.empty() || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            function(context, i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        taskFunction = function;
+        taskContext = context;
+        taskCount = count;
+        nextTask.store(0);
+        busyWorkers = static_cast<unsigned int>(threads.size());
+        ++generation;
+    }
+    startCondition.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+}
+
+void WorkerPool::workerLoop() {
+    unsigned int seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) {
+            doneCondition.notify_one();
+        }
+    }
+}
+
+void WorkerPool::drain() {
+    for (;;) {
+        int index = nextTask.fetch_add(1);
+        if (index >= taskCount) {
+            return;
+        }
+        taskFunction(taskContext, index);
+    }
+}
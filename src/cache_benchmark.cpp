@@ -0,0 +1,133 @@
+#include "NoiseGenerator.hpp"
+#include "OctaveCache.hpp"
+#include "TerrainSampler.hpp"
+#include "WorkerPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Drags the persistence slider over a cached map and compares each regeneration with
+// generating the map directly. Also times octave count changes and checks every cached
+// regeneration comes out the same as the direct one.
+
+namespace {
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --size N        Map size in pixels (default: 2048)\n"
+                  << "  --seed N        Noise seed (default: 1)\n"
+                  << "  --steps N       Persistence values between 0.1 and 1 (default: 20)\n"
+                  << "  --threads N     Pool threads, 1 runs on the calling thread only (default: 1)\n"
+                  << "  --budget MB     Cache memory budget (default: 256)\n";
+    }
+
+    template <typename Run>
+    double milliseconds(const Run& run) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int size = 2048;
+    int seed = 1;
+    int steps = 20;
+    unsigned int threads = 1;
+    std::size_t budget = OctaveCache::DefaultMemoryBudget;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = std::max(2, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10)) << 20;
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (size == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const float scale = 4.0f;
+    const int octaves = 6;
+    const std::size_t stride = static_cast<std::size_t>(size) * 4;
+
+    NoiseGenerator noiseGen;
+    noiseGen.setSeed(seed);
+    TerrainSampler terrain;
+    OctaveCache cache(budget);
+    std::unique_ptr<WorkerPool> pool(threads == 1 ? nullptr : new WorkerPool(threads));
+
+    std::vector<std::uint8_t> direct(stride * size);
+    std::vector<std::uint8_t> cached(stride * size);
+
+    // The first generation of a seed goes direct, the second builds the layers
+    double firstMilliseconds = milliseconds([&] {
+        cache.generateColors(terrain, noiseGen, scale, octaves, 0.5f, size, size, cached.data(), stride, pool.get());
+    });
+    double buildMilliseconds = milliseconds([&] {
+        cache.generateColors(terrain, noiseGen, scale, octaves, 0.5f, size, size, cached.data(), stride, pool.get());
+    });
+
+    double directTotal = 0.0;
+    double cachedTotal = 0.0;
+    double cachedWorst = 0.0;
+    std::size_t differentPixels = 0;
+    for (int step = 0; step < steps; ++step) {
+        float persistence = 0.1f + 0.9f * step / (steps - 1);
+        double cachedStep = milliseconds([&] {
+            cache.generateColors(terrain, noiseGen, scale, octaves, persistence, size, size, cached.data(), stride, pool.get());
+        });
+        cachedTotal += cachedStep;
+        cachedWorst = std::max(cachedWorst, cachedStep);
+
+        // Generated directly with the same rows per task as the cache uses
+        directTotal += milliseconds([&] {
+            if (pool) {
+                pool->parallelFor(static_cast<int>(size), [&](int row) {
+                    terrain.generateColors(noiseGen, scale, octaves, persistence, size, size, 0, static_cast<unsigned int>(row),
+                                           size, 1, direct.data() + row * stride, stride);
+                });
+            } else {
+                terrain.generateColors(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, direct.data(), stride);
+            }
+        });
+        for (std::size_t i = 0; i < direct.size(); i += 4) {
+            differentPixels += std::memcmp(&direct[i], &cached[i], 4) != 0 ? 1 : 0;
+        }
+    }
+
+    // Fewer octaves reuse layers, more only evaluate the new ones
+    double fewerMilliseconds = milliseconds([&] {
+        cache.generateColors(terrain, noiseGen, scale, 4, 0.5f, size, size, cached.data(), stride, pool.get());
+    });
+    double moreMilliseconds = milliseconds([&] {
+        cache.generateColors(terrain, noiseGen, scale, 8, 0.5f, size, size, cached.data(), stride, pool.get());
+    });
+
+    std::cout << size << "x" << size << " map, " << octaves << " octaves, " << cache.getCachedOctaves()
+              << " layers cached in " << (cache.getMemoryUsage() >> 20) << " MB\n"
+              << "  new seed (direct):       " << firstMilliseconds << " ms\n"
+              << "  building 6 layers:       " << buildMilliseconds << " ms\n"
+              << "  persistence, direct:     " << directTotal / steps << " ms per step\n"
+              << "  persistence, cached:     " << cachedTotal / steps << " ms per step, worst "
+              << cachedWorst << " ms, " << directTotal / cachedTotal << "x\n"
+              << "  6 -> 4 octaves:          " << fewerMilliseconds << " ms\n"
+              << "  4 -> 8 octaves:          " << moreMilliseconds << " ms (2 new layers)\n"
+              << "  pixels differing from direct generation: "
+              << 100.0 * differentPixels / (static_cast<double>(size) * size * steps) << "%" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "NoiseGenerator.hpp"
+#include "TerrainSampler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Compares the fused biome classification, which evaluates moisture and
+// temperature in the height loop and only on the lowlands, against three
+// separate passes over heights, moisture and temperature. The separate passes
+// run once over every pixel and once skipping all but the lowlands like the
+// fused loop, which leaves the fusion itself. Both run on the default terrain,
+// which is mostly sea, and on one that is lowland everywhere.
+
+namespace {
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --size N        Map size in pixels (default: 2048)\n"
+                  << "  --seed N        Noise seed (default: 1)\n"
+                  << "  --repeat N      Timed runs per variant, the best one counts (default: 3)\n";
+    }
+
+    template <typename Run>
+    double bestOf(int repeat, const Run& run) {
+        double best = 0.0;
+        for (int i = 0; i < repeat; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = i == 0 ? seconds : std::min(best, seconds);
+        }
+        return best;
+    }
+
+    void report(const char* name, double seconds, unsigned int size) {
+        double pixels = static_cast<double>(size) * size;
+        std::cout << "  " << name << seconds * 1000.0 << " ms, " << pixels / seconds / 1.0e6 << " Mpixels/s\n";
+    }
+
+    // Times every variant on one terrain with the climate enabled, returns whether all
+    // of them classify every pixel the same way
+    bool compare(const char* name, TerrainSampler terrain, const NoiseGenerator& noiseGen,
+                 unsigned int size, int repeat) {
+        const float scale = 4.0f;
+        const int octaves = 6;
+        const float persistence = 0.5f;
+
+        const std::size_t pixels = static_cast<std::size_t>(size) * size;
+        std::vector<std::uint8_t> fused(pixels);
+        std::vector<std::uint8_t> separate(pixels);
+        std::vector<std::uint8_t> separateLowland(pixels);
+        std::vector<float> heights(pixels);
+        std::vector<float> moisture(pixels);
+        std::vector<float> temperature(pixels);
+
+        double fusedSeconds = bestOf(repeat, [&] {
+            terrain.generateIndices(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, fused.data(), size);
+        });
+
+        // Same lowland test as the fused loop, the climate fields only matter there
+        auto isLowland = [&](float height) {
+            return height >= terrain.getSeaLevel() + terrain.getBeachSize() && height < terrain.getMountainLevel();
+        };
+        auto threePasses = [&](bool lowlandOnly, std::vector<std::uint8_t>& out) {
+            terrain.generateHeights(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, heights.data(), size);
+            for (unsigned int y = 0; y < size; ++y) {
+                for (unsigned int x = 0; x < size; ++x) {
+                    std::size_t i = static_cast<std::size_t>(y) * size + x;
+                    if (!lowlandOnly || isLowland(heights[i])) {
+                        moisture[i] = terrain.sampleMoisture(noiseGen, static_cast<float>(x) / size, static_cast<float>(y) / size);
+                    }
+                }
+            }
+            for (unsigned int y = 0; y < size; ++y) {
+                for (unsigned int x = 0; x < size; ++x) {
+                    std::size_t i = static_cast<std::size_t>(y) * size + x;
+                    if (!lowlandOnly || isLowland(heights[i])) {
+                        temperature[i] = terrain.sampleTemperature(noiseGen, static_cast<float>(x) / size, static_cast<float>(y) / size, heights[i]);
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < pixels; ++i) {
+                out[i] = terrain.getBiomePaletteIndex(heights[i], moisture[i], temperature[i]);
+            }
+        };
+        double separateSeconds = bestOf(repeat, [&] { threePasses(false, separate); });
+        double lowlandSeconds = bestOf(repeat, [&] { threePasses(true, separateLowland); });
+
+        // Cost of the height field alone for reference
+        TerrainSampler::ClimateSettings climate = terrain.getClimate();
+        climate.enabled = false;
+        TerrainSampler heightTerrain = terrain;
+        heightTerrain.setClimate(climate);
+        std::vector<std::uint8_t> heightOnly(pixels);
+        double heightSeconds = bestOf(repeat, [&] {
+            heightTerrain.generateIndices(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, heightOnly.data(), size);
+        });
+
+        std::size_t lowland = 0;
+        std::vector<std::size_t> counts(TerrainSampler::TerrainTypeCount, 0);
+        for (std::size_t i = 0; i < pixels; ++i) {
+            TerrainSampler::TerrainType type = TerrainSampler::getPaletteTerrainType(fused[i]);
+            ++counts[static_cast<std::size_t>(type)];
+            if (heightOnly[i] >= TerrainSampler::GrassPaletteIndex && heightOnly[i] < TerrainSampler::MountainPaletteIndex) {
+                ++lowland;
+            }
+        }
+
+        bool identical = fused == separate && fused == separateLowland;
+        std::cout << name << ", " << 100.0 * lowland / pixels << "% lowland pixels need the climate fields\n";
+        report("height only:          ", heightSeconds, size);
+        report("fused:                ", fusedSeconds, size);
+        report("three passes:         ", separateSeconds, size);
+        report("three passes lowland: ", lowlandSeconds, size);
+        std::cout << "  fused speedup:        " << separateSeconds / fusedSeconds << "x over every pixel, "
+                  << lowlandSeconds / fusedSeconds << "x from fusion alone, results "
+                  << (identical ? "identical" : "DIFFER") << "\n"
+                  << "  biome pixels:        ";
+        for (std::size_t type = static_cast<std::size_t>(TerrainSampler::TerrainType::Grass); type < counts.size(); ++type) {
+            std::cout << " " << counts[type];
+        }
+        std::cout << std::endl;
+        return identical;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int size = 2048;
+    int seed = 1;
+    int repeat = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (size == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    NoiseGenerator noiseGen;
+    noiseGen.setSeed(seed);
+    TerrainSampler terrain;
+    TerrainSampler::ClimateSettings climate;
+    climate.enabled = true;
+    terrain.setClimate(climate);
+
+    // Bounded evaluation would skip octaves in the fused loop only, generateHeights()
+    // always evaluates all of them, so it is off to compare just the climate work
+    terrain.setBoundedEvaluation(false);
+
+    std::cout << size << "x" << size << " map\n";
+    bool identical = compare("Default terrain", terrain, noiseGen, size, repeat);
+
+    // No sea, beach or mountains, so the lowland skip saves nothing
+    terrain.setSeaLevel(0.0f);
+    terrain.setBeachSize(0.0f);
+    terrain.setMountainLevel(1.0f);
+    terrain.setSnowLevel(1.0f);
+    identical = compare("All lowland", terrain, noiseGen, size, repeat) && identical;
+
+    return identical ? 0 : 1;
+}
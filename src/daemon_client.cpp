@@ -0,0 +1,192 @@
+#include "DaemonProtocol.hpp"
+#include "PngWriter.hpp"
+#include "TerrainSampler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Minimal local client for the generation daemon, used to try it out and to
+// measure round trips without any network involved
+
+namespace {
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --socket PATH       Daemon socket (default: $XDG_RUNTIME_DIR or /tmp, islandgen.sock)\n"
+                  << "  --size W H          Map size in pixels (default: 512 512)\n"
+                  << "  --seed N            Noise seed (default: 1)\n"
+                  << "  --scale F           Noise scale (default: 4.0)\n"
+                  << "  --octaves N         Octave count (default: 6)\n"
+                  << "  --persistence F     Persistence (default: 0.5)\n"
+                  << "  --heights           Request float heights instead of RGBA colors\n"
+                  << "  --indices           Request terrain palette indices instead of RGBA colors\n"
+                  << "  --count N           Requests sent before reading any reply (default: 1)\n"
+                  << "  --out FILE          Write the first result as PPM (colors), raw float32 (heights)\n"
+                  << "                      or 8-bit indexed PNG (indices)\n";
+    }
+
+    bool receiveResponse(int socketFd, DaemonProtocol::Response& response, int& memoryFd) {
+        iovec payload;
+        payload.iov_base = &response;
+        payload.iov_len = sizeof(response);
+
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = &payload;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        memoryFd = -1;
+        if (recvmsg(socketFd, &message, MSG_WAITALL) != static_cast<ssize_t>(sizeof(response))) {
+            return false;
+        }
+        for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+                std::memcpy(&memoryFd, CMSG_DATA(header), sizeof(int));
+            }
+        }
+        return response.magic == DaemonProtocol::Magic;
+    }
+
+    void writeResult(const std::string& filename, const DaemonProtocol::Response& response, const unsigned char* data) {
+        if (response.output == DaemonProtocol::OutputIndices) {
+            std::vector<PngWriter::PaletteEntry> palette;
+            for (const auto& color : TerrainSampler::getPalette()) {
+                palette.push_back(PngWriter::PaletteEntry{color.r, color.g, color.b});
+            }
+            PngWriter::writeIndexed(filename, response.width, response.height, data, response.width,
+                                    palette.data(), palette.size());
+            return;
+        }
+
+        std::ofstream file(filename, std::ios::binary);
+        if (response.output == DaemonProtocol::OutputHeights) {
+            file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(response.byteSize));
+            return;
+        }
+
+        file << "P6\n" << response.width << " " << response.height << "\n255\n";
+        std::size_t pixels = static_cast<std::size_t>(response.width) * response.height;
+        for (std::size_t i = 0; i < pixels; ++i) {
+            file.write(reinterpret_cast<const char*>(data + i * 4), 3);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    std::string socketPath = std::string(runtimeDir ? runtimeDir : "/tmp") + "/islandgen.sock";
+    std::string outputFile;
+    int count = 1;
+
+    DaemonProtocol::Request request;
+    std::memset(&request, 0, sizeof(request));
+    request.magic = DaemonProtocol::Magic;
+    request.version = DaemonProtocol::Version;
+    request.output = DaemonProtocol::OutputColors;
+    request.width = 512;
+    request.height = 512;
+    request.seed = 1;
+    request.scale = 4.0f;
+    request.octaves = 6;
+    request.persistence = 0.5f;
+    request.seaLevel = 0.500f;
+    request.beachSize = 0.030f;
+    request.mountainLevel = 0.610f;
+    request.snowLevel = 0.700f;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--size" && i + 2 < argc) {
+            request.width = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            request.height = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            request.seed = std::atoi(argv[++i]);
+        } else if (arg == "--scale" && i + 1 < argc) {
+            request.scale = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--octaves" && i + 1 < argc) {
+            request.octaves = std::atoi(argv[++i]);
+        } else if (arg == "--persistence" && i + 1 < argc) {
+            request.persistence = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--heights") {
+            request.output = DaemonProtocol::OutputHeights;
+        } else if (arg == "--indices") {
+            request.output = DaemonProtocol::OutputIndices;
+        } else if (arg == "--count" && i + 1 < argc) {
+            count = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--out" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    int socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    if (socketFd < 0 || connect(socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Error: could not connect to " << socketPath << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Requests are pipelined, the daemon answers them in order
+    for (int i = 0; i < count; ++i) {
+        request.requestId = static_cast<std::uint32_t>(i);
+        if (send(socketFd, &request, sizeof(request), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(request))) {
+            std::cerr << "Error: failed to send request " << i << std::endl;
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        DaemonProtocol::Response response;
+        int memoryFd = -1;
+        if (!receiveResponse(socketFd, response, memoryFd)) {
+            std::cerr << "Error: no valid response for request " << i << std::endl;
+            return 1;
+        }
+        if (response.status != DaemonProtocol::StatusOk || memoryFd < 0) {
+            std::cerr << "Error: request " << response.requestId << " failed with status " << response.status << std::endl;
+            return 1;
+        }
+
+        void* data = mmap(nullptr, response.byteSize, PROT_READ, MAP_SHARED, memoryFd, 0);
+        close(memoryFd);
+        if (data == MAP_FAILED) {
+            std::cerr << "Error: could not map result of request " << response.requestId << std::endl;
+            return 1;
+        }
+        if (i == 0 && !outputFile.empty()) {
+            try {
+                writeResult(outputFile, response, static_cast<const unsigned char*>(data));
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+            }
+        }
+        munmap(data, response.byteSize);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << count << " map(s) of " << request.width << "x" << request.height
+              << " in " << seconds * 1000.0 << " ms (" << seconds * 1000.0 / count << " ms per map)" << std::endl;
+
+    close(socketFd);
+    return 0;
+}
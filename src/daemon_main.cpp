@@ -0,0 +1,59 @@
+#include "GenerationDaemon.hpp"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+    GenerationDaemon* activeDaemon = nullptr;
+
+    void handleSignal(int) {
+        if (activeDaemon) {
+            activeDaemon->stop();
+        }
+    }
+
+    std::string defaultSocketPath() {
+        const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+        return std::string(runtimeDir ? runtimeDir : "/tmp") + "/islandgen.sock";
+    }
+
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [--socket PATH] [--threads N]\n"
+                  << "  --socket PATH  Unix domain socket to listen on (default: " << defaultSocketPath() << ")\n"
+                  << "  --threads N    Worker threads, 0 uses every core (default: 0)\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string socketPath = defaultSocketPath();
+    unsigned int threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    try {
+        GenerationDaemon daemon(socketPath, threads);
+        activeDaemon = &daemon;
+        std::signal(SIGINT, handleSignal);
+        std::signal(SIGTERM, handleSignal);
+
+        std::cout << "Island generator daemon listening on " << socketPath << std::endl;
+        daemon.run();
+        activeDaemon = nullptr;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
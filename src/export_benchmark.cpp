@@ -0,0 +1,144 @@
+#include "ExportQueue.hpp"
+#include "NoiseGenerator.hpp"
+#include "PngWriter.hpp"
+#include "TerrainSampler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs a stand-in for the UI frame loop, generating one map tile per frame and polling
+// the export queue, first alone and then while a batch of seed variants is generated
+// and encoded on the queue. Compares the frame times of both phases and reports how
+// long the same export would have stalled a frame if it ran on the UI thread.
+
+namespace {
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --size N        Variant size in pixels (default: 2048)\n"
+                  << "  --variants N    Seed variants in the batch (default: 8)\n"
+                  << "  --threads N     Export threads, 0 leaves one core to the frame loop (default: 0)\n"
+                  << "  --tile N        Tile size generated per frame (default: 128)\n"
+                  << "  --frames N      Frames of the idle phase (default: 120)\n";
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double percentile(std::vector<double> values, double fraction) {
+        std::sort(values.begin(), values.end());
+        std::size_t index = static_cast<std::size_t>(fraction * (values.size() - 1) + 0.5);
+        return values[index];
+    }
+
+    void printFrames(const char* name, const std::vector<double>& frames) {
+        std::cout << "  " << name << frames.size() << " frames, p50 " << percentile(frames, 0.5)
+                  << " ms, p99 " << percentile(frames, 0.99) << " ms, max "
+                  << *std::max_element(frames.begin(), frames.end()) << " ms\n";
+    }
+
+    // Same steps as an exported variant, encoded to memory instead of a file
+    std::size_t exportVariant(const TerrainSampler& terrain, int seed, unsigned int size, ExportQueue::Context* context) {
+        NoiseGenerator noiseGen;
+        noiseGen.setSeed(seed);
+        const unsigned int blockRows = 32;
+        const std::size_t stride = static_cast<std::size_t>(size) * 4;
+        std::vector<std::uint8_t> pixels(stride * size);
+        for (unsigned int top = 0; top < size; top += blockRows) {
+            if (context && context->isCancelled()) {
+                return 0;
+            }
+            unsigned int rows = std::min(blockRows, size - top);
+            terrain.generateColors(noiseGen, 4.0f, 6, 0.5f, size, size, 0, top, size, rows, pixels.data() + top * stride, stride);
+            if (context) {
+                context->setProgress(0.5f * (top + rows) / size);
+            }
+        }
+        return PngWriter::encodeRGBA(size, size, pixels.data(), stride).size();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int size = 2048;
+    int variants = 8;
+    unsigned int threads = 0;
+    unsigned int tile = 128;
+    int idleFrames = 120;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--variants") == 0 && i + 1 < argc) {
+            variants = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--tile") == 0 && i + 1 < argc) {
+            tile = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            idleFrames = std::max(1, std::atoi(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (size == 0 || tile == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    TerrainSampler terrain;
+    NoiseGenerator frameNoise;
+    std::vector<std::uint8_t> tilePixels(static_cast<std::size_t>(tile) * tile * 4);
+    ExportQueue queue(threads);
+
+    // One frame of the stand-in UI, a tile at a different place each time
+    int frameIndex = 0;
+    auto frame = [&]() {
+        auto start = std::chrono::steady_clock::now();
+        unsigned int offset = static_cast<unsigned int>(frameIndex++ % 64) * tile;
+        terrain.generateColors(frameNoise, 4.0f, 6, 0.5f, tile * 64, tile * 64, offset, offset, tile, tile,
+                               tilePixels.data(), static_cast<std::size_t>(tile) * 4);
+        queue.getStatus();
+        return millisecondsSince(start);
+    };
+
+    std::vector<double> idle;
+    for (int i = 0; i < idleFrames; ++i) {
+        idle.push_back(frame());
+    }
+
+    // The same batch the UI submits, one job per variant
+    std::atomic<std::size_t> encodedBytes(0);
+    auto batchStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < variants; ++i) {
+        queue.submit("seed " + std::to_string(i + 1), [&terrain, &encodedBytes, i, size](ExportQueue::Context& context) {
+            encodedBytes += exportVariant(terrain, i + 1, size, &context);
+        });
+    }
+    std::vector<double> busy;
+    while (queue.getPendingCount() > 0) {
+        busy.push_back(frame());
+    }
+    double batchMilliseconds = millisecondsSince(batchStart);
+
+    // What a single export costs when it runs inside a frame
+    auto syncStart = std::chrono::steady_clock::now();
+    exportVariant(terrain, 1, size, nullptr);
+    double syncMilliseconds = millisecondsSince(syncStart);
+
+    std::cout << variants << " variants of " << size << "x" << size << " on " << queue.getThreadCount()
+              << " export threads, " << tile << "x" << tile << " tile per frame\n";
+    printFrames("idle:      ", idle);
+    printFrames("exporting: ", busy);
+    std::cout << "  batch:     " << batchMilliseconds << " ms, " << batchMilliseconds / variants << " ms per variant, "
+              << (encodedBytes >> 10) << " KB encoded\n"
+              << "  one export on the frame thread would stall it for " << syncMilliseconds << " ms" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,285 @@
+#include "islandgen.h"
+#include "NoiseGenerator.hpp"
+#include "TerrainSampler.hpp"
+#include "WorkerPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <new>
+
+struct islandgen_generator {
+    islandgen_params params;
+    NoiseGenerator noiseGen;
+    TerrainSampler terrain;
+
+    // Created once by islandgen_set_thread_count so generating never allocates
+    std::unique_ptr<WorkerPool> pool;
+};
+
+namespace {
+    // Rows handed to a worker at once
+    const uint32_t RowsPerBlock = 16;
+
+    bool isValid(const islandgen_params& params) {
+        return std::isfinite(params.scale) && params.scale > 0.0f
+            && params.octaves >= 1 && params.octaves <= 16
+            && std::isfinite(params.persistence) && params.persistence > 0.0f
+            && std::isfinite(params.sea_level) && std::isfinite(params.beach_size)
+            && std::isfinite(params.mountain_level) && std::isfinite(params.snow_level);
+    }
+
+    bool isValid(const islandgen_climate& climate) {
+        return std::isfinite(climate.scale) && climate.scale > 0.0f
+            && climate.octaves >= 1 && climate.octaves <= 16
+            && std::isfinite(climate.lapse_rate);
+    }
+
+    void applyParams(islandgen_generator& generator, const islandgen_params& params) {
+        generator.params = params;
+        generator.noiseGen.setSeed(params.seed);
+        generator.terrain.setSeaLevel(params.sea_level);
+        generator.terrain.setBeachSize(params.beach_size);
+        generator.terrain.setMountainLevel(params.mountain_level);
+        generator.terrain.setSnowLevel(params.snow_level);
+    }
+
+    bool isValidRect(uint32_t width, uint32_t height, uint32_t left, uint32_t top,
+                     uint32_t columns, uint32_t rows, size_t stride, size_t pixelSize) {
+        return width > 0 && height > 0
+            && left < width && top < height
+            && columns > 0 && rows > 0
+            && columns <= width - left && rows <= height - top
+            && stride >= static_cast<size_t>(columns) * pixelSize;
+    }
+
+    // Split the rectangle into row blocks and run them on the generator's threads
+    template <typename Fill>
+    void generateRows(islandgen_generator& generator, uint32_t rows, const Fill& fill) {
+        int blocks = static_cast<int>((rows + RowsPerBlock - 1) / RowsPerBlock);
+        auto task = [&](int block) {
+            uint32_t first = static_cast<uint32_t>(block) * RowsPerBlock;
+            fill(first, std::min(RowsPerBlock, rows - first));
+        };
+
+        if (generator.pool) {
+            generator.pool->parallelFor(blocks, task);
+        } else {
+            for (int block = 0; block < blocks; ++block) {
+                task(block);
+            }
+        }
+    }
+}
+
+extern "C" {
+
+unsigned int islandgen_api_version(void) {
+    return ISLANDGEN_API_VERSION;
+}
+
+const char* islandgen_status_string(islandgen_status status) {
+    switch (status) {
+        case ISLANDGEN_OK: return "ok";
+        case ISLANDGEN_INVALID_ARGUMENT: return "invalid argument";
+        case ISLANDGEN_OUT_OF_MEMORY: return "out of memory";
+        case ISLANDGEN_INTERNAL_ERROR: return "internal error";
+    }
+    return "unknown status";
+}
+
+void islandgen_default_params(islandgen_params* params) {
+    if (!params) {
+        return;
+    }
+    params->seed = 1;
+    params->scale = 4.0f;
+    params->octaves = 6;
+    params->persistence = 0.5f;
+    params->sea_level = 0.500f;
+    params->beach_size = 0.030f;
+    params->mountain_level = 0.610f;
+    params->snow_level = 0.700f;
+}
+
+islandgen_status islandgen_create(const islandgen_params* params, islandgen_generator** generator) {
+    if (!generator) {
+        return ISLANDGEN_INVALID_ARGUMENT;
+    }
+    *generator = nullptr;
+
+    islandgen_params initial;
+    if (params) {
+        initial = *params;
+    } else {
+        islandgen_default_params(&initial);
+    }
+    if (!isValid(initial)) {
+        return ISLANDGEN_INVALID_ARGUMENT;
+    }
+
+    islandgen_generator* created = new (std::nothrow) islandgen_generator();
+    if (!created) {
+        return ISLANDGEN_OUT_OF_MEMORY;
+    }
+    applyParams(*created, initial);
+    *generator = created;
+    return ISLANDGEN_OK;
+}
+
+void islandgen_destroy(islandgen_generator* generator) {
+    delete generator;
+}
+
+islandgen_status islandgen_set_params(islandgen_generator* generator, const islandgen_params* params) {
+    if (!generator || !params || !isValid(*params)) {
+        return ISLANDGEN_INVALID_ARGUMENT;
+    }
+    applyParams(*generator, *params);
+    return ISLANDGEN_OK;
+}
+
+void islandgen_default_climate(islandgen_climate* climate) {
+    if (!climate) {
+        return;
+    }
+    TerrainSampler::ClimateSettings defaults;
+    climate->enabled = defaults.enabled ? 1 : 0;
+    climate->scale = defaults.scale;
+    climate->octaves = defaults.octaves;
+    climate->moisture_seed_offset = defaults.moistureSeedOffset;
+    climate->temperature_seed_offset = defaults.temperatureSeedOffset;
+    climate->lapse_rate = defaults.lapseRate;
+}
+
+islandgen_status islandgen_set_climate(islandgen_generator* generator, const islandgen_climate* climate) {
+    if (!generator || !climate || !isValid(*climate)) {
+        return ISLANDGEN_INVALID_ARGUMENT;
+    }
+
+    TerrainSampler::ClimateSettings settings;
+    settings.enabled = climate->enabled != 0;
+    settings.scale = climate->scale;
+    settings.octaves = climate->octaves;
+    settings.moistureSeedOffset = climate->moisture_seed_offset;
+    settings.temperatureSeedOffset = climate->temperature_seed_offset;
+    settings.lapseRate = climate->lapse_rate;
+    generator->terrain.setClimate(settings);
+    return ISLANDGEN_OK;
+}
+
+islandgen_status islandgen_set_thread_count(islandgen_generator* generator, unsigned int threads) {
+    if (!generator) {
+        return ISLANDGEN_INVALID_ARGUMENT;
+    }
+
+    try {
+        if (threads == 1) {
+            generator->pool.reset();
+        } else {
+            generator->pool.reset(new WorkerPool(threads));
+        }
+    } catch (const std::bad_alloc&) {
+        return ISLANDGEN_OUT_OF_MEMORY;
+    } catch (...) {
+        return ISLANDGEN_INTERNAL_ERROR;
+    }
+    return ISLANDGEN_OK;
+}
+
+islandgen_status islandgen_generate_heights(islandgen_generator* generator,
+                                            uint32_t width, uint32_t height,
+                                            float* heights, size_t stride) {
+    return islandgen_generate_heights_rect(generator, width, height, 0, 0, width, height, heights, stride);
+}
+
+islandgen_status islandgen_generate_rgba(islandgen_generator* generator,
+                                         uint32_t width, uint32_t height,
+                                         uint8_t* pixels, size_t stride) {
+    return islandgen_generate_rgba_rect(generator, width, height, 0, 0, width, height, pixels, stride);
+}
+
+islandgen_status islandgen_generate_heights_rect(islandgen_generator* generator,
+                                                 uint32_t width, uint32_t height,
+                                                 uint32_t left, uint32_t top,
+                                                 uint32_t columns, uint32_t rows,
+                                                 float* heights, size_t stride) {
+    if (!generator || !heights || stride % sizeof(float) != 0
+        || !isValidRect(width, height, left, top, columns, rows, stride, sizeof(float))) {
+        return ISLANDGEN_INVALID_ARGUMENT;
+    }
+
+    const islandgen_generator& gen = *generator;
+    const size_t rowStride = stride / sizeof(float);
+    generateRows(*generator, rows, [&](uint32_t first, uint32_t count) {
+        gen.terrain.generateHeights(gen.noiseGen, gen.params.scale, gen.params.octaves, gen.params.persistence,
+                                    width, height, left, top + first, columns, count,
+                                    heights + first * rowStride, rowStride);
+    });
+    return ISLANDGEN_OK;
+}
+
+islandgen_status islandgen_generate_rgba_rect(islandgen_generator* generator,
+                                              uint32_t width, uint32_t height,
+                                              uint32_t left, uint32_t top,
+                                              uint32_t columns, uint32_t rows,
+                                              uint8_t* pixels, size_t stride) {
+    if (!generator || !pixels || !isValidRect(width, height, left, top, columns, rows, stride, 4)) {
+        return ISLANDGEN_INVALID_ARGUMENT;
+    }
+
+    const islandgen_generator& gen = *generator;
+    generateRows(*generator, rows, [&](uint32_t first, uint32_t count) {
+        gen.terrain.generateColors(gen.noiseGen, gen.params.scale, gen.params.octaves, gen.params.persistence,
+                                   width, height, left, top + first, columns, count,
+                                   pixels + first * stride, stride);
+    });
+    return ISLANDGEN_OK;
+}
+
+islandgen_status islandgen_generate_indices(islandgen_generator* generator,
+                                            uint32_t width, uint32_t height,
+                                            uint8_t* indices, size_t stride) {
+    return islandgen_generate_indices_rect(generator, width, height, 0, 0, width, height, indices, stride);
+}
+
+islandgen_status islandgen_generate_indices_rect(islandgen_generator* generator,
+                                                 uint32_t width, uint32_t height,
+                                                 uint32_t left, uint32_t top,
+                                                 uint32_t columns, uint32_t rows,
+                                                 uint8_t* indices, size_t stride) {
+    if (!generator || !indices || !isValidRect(width, height, left, top, columns, rows, stride, 1)) {
+        return ISLANDGEN_INVALID_ARGUMENT;
+    }
+
+    const islandgen_generator& gen = *generator;
+    generateRows(*generator, rows, [&](uint32_t first, uint32_t count) {
+        gen.terrain.generateIndices(gen.noiseGen, gen.params.scale, gen.params.octaves, gen.params.persistence,
+                                    width, height, left, top + first, columns, count,
+                                    indices + first * stride, stride);
+    });
+    return ISLANDGEN_OK;
+}
+
+islandgen_status islandgen_get_palette(uint8_t* colors, size_t capacity, size_t* count) {
+    const auto& palette = TerrainSampler::getPalette();
+    if (count) {
+        *count = palette.size();
+    }
+    if (!colors || capacity < palette.size()) {
+        return colors || !count ? ISLANDGEN_INVALID_ARGUMENT : ISLANDGEN_OK;
+    }
+
+    for (size_t i = 0; i < palette.size(); ++i) {
+        colors[i * 4 + 0] = palette[i].r;
+        colors[i * 4 + 1] = palette[i].g;
+        colors[i * 4 + 2] = palette[i].b;
+        colors[i * 4 + 3] = palette[i].a;
+    }
+    return ISLANDGEN_OK;
+}
+
+islandgen_terrain_type islandgen_palette_terrain_type(uint8_t index) {
+    return static_cast<islandgen_terrain_type>(TerrainSampler::getPaletteTerrainType(index));
+}
+
+}
@@ -4,11 +4,17 @@
 #include <backends/imgui_impl_opengl3.hpp>
 #include "NoiseGenerator.hpp"
 #include "IslandGenerator.hpp"
+#include "ExportQueue.hpp"
+#include "TileCache.hpp"
+#include "SessionTrace.hpp"
 #include <windows.h>
 #include <shobjidl.h> 
 #include <filesystem>
 #include <shlobj.h>
 #include <random>
+#include <cmath>
+#include <cstring>
+#include <memory>
 
 // Global texture for ImGui font
 sf::Texture* g_fontTexture = nullptr;
@@ -185,7 +191,15 @@ std::string ShowFolderDialog() {
     return folderPath;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // --record FILE logs every regeneration for headless replay with islandgen_replay
+    std::string recordFile;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--record") == 0) {
+            recordFile = argv[++i];
+        }
+    }
+    
     // Get screen resolution
     sf::Vector2u screenSize = GetScreenResolution();
     
@@ -216,12 +230,17 @@ int main() {
     // Create generators
     NoiseGenerator noiseGen;
     IslandGenerator islandGen(512, 512);
+    TileCache tileCache;
+    
+    // Exports are encoded and written on background threads, one core is left to the UI
+    ExportQueue exportQueue;
     
     // Parameters
     float scale = 4.0f;
     int octaves = 6;
     float persistence = 0.5f;
     int seed = 1;
+    bool octaveCache = true;
     
     // Terrain parameters
     float seaLevel = 0.500f;
@@ -229,18 +248,95 @@ int main() {
     float mountainLevel = 0.610f;
     float snowLevel = 0.700f;
     
+    // Climate parameters
+    TerrainSampler::ClimateSettings climate;
+    
+    // Lighting parameters
+    bool shading = false;
+    float lightAzimuth = 315.0f;
+    float lightElevation = 45.0f;
+    float relief = 0.25f;
+    
+    // Map view, zoom 1 fits the whole world and the center is in normalized world coordinates
+    const float maxMapZoom = 4096.0f;
+    float mapZoom = 1.0f;
+    double mapCenterX = 0.5;
+    double mapCenterY = 0.5;
+    
     // Export parameters
     static std::string selectedExportPath;
+    int exportFormat = 0;
+    const char* exportFormats[] = { "RGBA PNG", "Indexed PNG (8-bit)" };
+    bool exportFeatures = false;
+    bool exportMesh = false;
+    int meshFormat = 0;
+    const char* meshFormats[] = { "glTF Binary (.glb)", "Wavefront OBJ" };
+    float meshMaxError = 0.5f;
+    
+    // Batch export, consecutive seeds from the current one times evenly spread persistence values
+    int batchSeeds = 4;
+    int batchPersistenceSteps = 1;
+    float batchPersistenceMin = 0.3f;
+    float batchPersistenceMax = 0.7f;
     
     // Status message
     std::string statusMessage = "Welcome to Island Generator! Adjust parameters to generate your island.";
     float statusMessageTimer = 5.0f;
     
-    // Generate initial island
-    islandGen.generate(noiseGen, scale, octaves, persistence);
+    // Session recording, every regeneration is logged with the parameters it used
+    std::unique_ptr<SessionTrace::Recorder> recorder;
+    if (!recordFile.empty()) {
+        try {
+            recorder.reset(new SessionTrace::Recorder(recordFile, 512, 512));
+        } catch (const std::exception& e) {
+            statusMessage = "Error starting recording: " + std::string(e.what());
+        }
+    }
     
-    // Create sprite for displaying the texture
-    sf::Sprite displaySprite(islandGen.getTexture());
+    // A change is logged once the map view shows all of its tiles, or when the next change replaces it
+    SessionTrace::Parameters recordedParameters;
+    bool awaitingTiles = false;
+    sf::Clock changeClock;
+    // Nothing is generated here, the map view builds its tiles on the tile cache workers
+    auto recordChange = [&]() {
+        if (awaitingTiles) {
+            recorder->record(recordedParameters, changeClock.getElapsedTime().asMicroseconds() / 1000.0, false);
+        }
+        changeClock.restart();
+        if (recorder) {
+            SessionTrace::Parameters parameters;
+            parameters.seed = seed;
+            parameters.scale = scale;
+            parameters.octaves = octaves;
+            parameters.persistence = persistence;
+            parameters.seaLevel = seaLevel;
+            parameters.beachSize = beachSize;
+            parameters.mountainLevel = mountainLevel;
+            parameters.snowLevel = snowLevel;
+            parameters.shading = shading;
+            parameters.lightAzimuth = lightAzimuth;
+            parameters.lightElevation = lightElevation;
+            parameters.relief = relief;
+            parameters.indexed = islandGen.getOutputMode() == IslandGenerator::OutputMode::Indexed;
+            parameters.octaveCache = octaveCache;
+            parameters.climate = climate;
+            recordedParameters = parameters;
+            awaitingTiles = true;
+        }
+    };
+    
+    // Record the initial island
+    recordChange();
+    
+    // Files written next to every exported image
+    auto currentExportOptions = [&]() {
+        IslandGenerator::ExportOptions options;
+        options.features = exportFeatures;
+        options.mesh = exportMesh;
+        options.meshObj = meshFormat == 1;
+        options.meshOptions.maxError = meshMaxError;
+        return options;
+    };
     
     // Initial window positions and sizes
     ImVec2 controlsPos(20, 20);
@@ -298,6 +394,13 @@ int main() {
             if (ImGui::SliderFloat("Scale", &scale, 1.0f, 10.0f)) regenerate = true;
             if (ImGui::SliderInt("Octaves", &octaves, 1, 8)) regenerate = true;
             if (ImGui::SliderFloat("Persistence", &persistence, 0.1f, 1.0f)) regenerate = true;
+            if (ImGui::Checkbox("Cache Octave Layers", &octaveCache)) {
+                islandGen.setOctaveCache(octaveCache);
+                regenerate = true;
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Keep each octave of the zoomed out map so persistence, octave and level changes only recombine them (unshaded)");
+            }
             
             // Seed input and random button on same line
             ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.6f);
@@ -339,6 +442,10 @@ int main() {
                 mountainLevel = 0.61f;  // Rounded from 0.610
                 snowLevel = 0.70f;     // From 0.700
                 
+                // Reset climate parameters
+                climate = TerrainSampler::ClimateSettings();
+                islandGen.setClimate(climate);
+                
                 regenerate = true;
             }
             if (ImGui::IsItemHovered()) {
@@ -363,19 +470,60 @@ int main() {
                 islandGen.setSnowLevel(snowLevel);
                 regenerate = true;
             }
+            
+            bool climateChanged = ImGui::Checkbox("Climate Biomes", &climate.enabled);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Split the lowlands into Whittaker biomes using moisture and temperature noise");
+            }
+            if (climate.enabled) {
+                climateChanged |= ImGui::SliderFloat("Climate Scale", &climate.scale, 0.5f, 5.0f);
+                climateChanged |= ImGui::SliderFloat("Lapse Rate", &climate.lapseRate, 0.0f, 5.0f);
+            }
+            if (climateChanged) {
+                islandGen.setClimate(climate);
+                regenerate = true;
+            }
+        }
+        
+        if (ImGui::CollapsingHeader("View", ImGuiTreeNodeFlags_DefaultOpen)) {
+            ImGui::Text("Zoom: %.1fx (level %d, %d octaves)", mapZoom, tileCache.getLevel(), tileCache.getOctaves());
+            if (tileCache.getPendingTiles() > 0) {
+                ImGui::Text("Refining %d tiles...", tileCache.getPendingTiles());
+            }
+            if (ImGui::Button("Reset View")) {
+                mapZoom = 1.0f;
+                mapCenterX = 0.5;
+                mapCenterY = 0.5;
+            }
+            ImGui::TextWrapped("Scroll over the map to zoom, drag with the left mouse button to pan.");
+            
+            ImGui::Separator();
+            
+            bool lightingChanged = false;
+            if (ImGui::Checkbox("Directional Light", &shading)) {
+                islandGen.setShading(shading);
+                regenerate = true;
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Hillshade the land and generate a normal map for export");
+            }
+            if (shading) {
+                if (ImGui::SliderFloat("Light Azimuth", &lightAzimuth, 0.0f, 360.0f)) lightingChanged = true;
+                if (ImGui::SliderFloat("Light Elevation", &lightElevation, 5.0f, 90.0f)) lightingChanged = true;
+                if (ImGui::SliderFloat("Relief", &relief, 0.05f, 1.0f)) lightingChanged = true;
+            }
+            if (lightingChanged) {
+                islandGen.setLighting(lightAzimuth, lightElevation, relief);
+                regenerate = true;
+            }
         }
         
         // Regenerate if any parameter changed
         if (regenerate) {
-            try {
-                islandGen.generate(noiseGen, scale, octaves, persistence);
-                displaySprite.setTexture(islandGen.getTexture(), true);
-                statusMessage = "Island updated with new parameters!";
-                statusMessageTimer = 2.0f;
-            } catch (const std::exception& e) {
-                statusMessage = "Error generating island: " + std::string(e.what());
-                statusMessageTimer = 5.0f;
-            }
+            tileCache.clear();
+            recordChange();
+            statusMessage = "Island updated with new parameters!";
+            statusMessageTimer = 2.0f;
         }
         
         ImGui::Separator();
@@ -405,7 +553,32 @@ int main() {
                 }
             }
             
-            ImGui::SameLine();
+            // Indexed output keeps one palette index per pixel instead of RGBA
+            if (ImGui::Combo("Format", &exportFormat, exportFormats, 2)) {
+                islandGen.setOutputMode(exportFormat == 1 ? IslandGenerator::OutputMode::Indexed
+                                                          : IslandGenerator::OutputMode::Color);
+                recordChange();
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Indexed PNGs store terrain palette indices, a quarter of the size of RGBA (unshaded)");
+            }
+            
+            ImGui::Checkbox("Feature Placement", &exportFeatures);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Also write trees, rocks and settlements as a binary instance list (_features.bin)");
+            }
+            
+            ImGui::Checkbox("3D Mesh", &exportMesh);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Also write the terrain as an adaptive triangle mesh (_mesh.glb or _mesh.obj)");
+            }
+            if (exportMesh) {
+                ImGui::Combo("Mesh Format", &meshFormat, meshFormats, 2);
+                ImGui::SliderFloat("Mesh Max Error", &meshMaxError, 0.05f, 4.0f, "%.2f");
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Largest height difference between mesh and heightmap, 1 unit per pixel and 64 units of relief");
+                }
+            }
             
             // Export button (only enabled if directory is selected)
             if (ImGui::Button("Export Now", ImVec2(120, 0))) {
@@ -413,27 +586,117 @@ int main() {
                     statusMessage = "Please select an export directory first!";
                     statusMessageTimer = 5.0f;
                 } else {
-                    try {
-                        // Create filename with seed and timestamp
-                        auto now = std::chrono::system_clock::now();
-                        auto timestamp = std::chrono::system_clock::to_time_t(now);
-                        std::string filename = "island_seed" + std::to_string(seed) + "_" + 
-                                             std::to_string(timestamp) + ".png";
-                        
-                        // Combine folder path and filename
-                        std::string fullPath = selectedExportPath + "\\" + filename;
-                        
-                        islandGen.exportToPNG(fullPath);
-                        statusMessage = "Island exported successfully!\nLocation: " + fullPath;
-                        statusMessageTimer = 8.0f;
-                    } catch (const std::exception& e) {
-                        statusMessage = "Error exporting PNG: " + std::string(e.what());
-                        statusMessageTimer = 5.0f;
-                    }
+                    // Create filename with seed and timestamp
+                    auto now = std::chrono::system_clock::now();
+                    auto timestamp = std::chrono::system_clock::to_time_t(now);
+                    std::string filename = "island_seed" + std::to_string(seed) + "_" + 
+                                         std::to_string(timestamp) + ".png";
+                    
+                    // Combine folder path and filename
+                    std::string fullPath = selectedExportPath + "\\" + filename;
+                    
+                    // Only the settings are taken on this thread, the map is generated and encoded on the queue
+                    IslandGenerator::Snapshot snapshot = islandGen.snapshotSettings(noiseGen, scale, octaves, persistence);
+                    IslandGenerator::ExportOptions options = currentExportOptions();
+                    exportQueue.submit(filename, [snapshot, fullPath, options](ExportQueue::Context& context) mutable {
+                        if (IslandGenerator::render(snapshot, context)) {
+                            IslandGenerator::writeSnapshot(snapshot, fullPath, options, context);
+                        }
+                    });
+                    statusMessage = "Exporting in the background\nLocation: " + fullPath;
+                    statusMessageTimer = 8.0f;
                 }
             }
             
             ImGui::TextWrapped("First select a directory, then click Export Now to save your island image.");
+            
+            // Variants are generated from the current settings on the export threads, in parallel
+            ImGui::Separator();
+            ImGui::Text("Batch Export");
+            if (ImGui::InputInt("Seeds", &batchSeeds)) {
+                batchSeeds = std::max(1, std::min(256, batchSeeds));
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Consecutive seeds starting at the current one");
+            }
+            if (ImGui::InputInt("Persistence Steps", &batchPersistenceSteps)) {
+                batchPersistenceSteps = std::max(1, std::min(16, batchPersistenceSteps));
+            }
+            if (batchPersistenceSteps > 1) {
+                ImGui::DragFloatRange2("Persistence Range", &batchPersistenceMin, &batchPersistenceMax,
+                                       0.01f, 0.1f, 1.0f, "%.2f");
+            }
+            if (ImGui::Button("Export Batch", ImVec2(120, 0))) {
+                if (selectedExportPath.empty()) {
+                    statusMessage = "Please select an export directory first!";
+                    statusMessageTimer = 5.0f;
+                } else {
+                    // Settings only, every variant generates its own pixels
+                    IslandGenerator::Snapshot base = islandGen.snapshotSettings(noiseGen, scale, octaves, persistence);
+                    IslandGenerator::ExportOptions options = currentExportOptions();
+                    auto timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+                    
+                    for (int i = 0; i < batchSeeds; ++i) {
+                        for (int step = 0; step < batchPersistenceSteps; ++step) {
+                            IslandGenerator::Snapshot variant = base;
+                            variant.noiseGen.setSeed(seed + i);
+                            if (batchPersistenceSteps > 1) {
+                                variant.persistence = batchPersistenceMin +
+                                    (batchPersistenceMax - batchPersistenceMin) * step / (batchPersistenceSteps - 1);
+                            }
+                            std::string filename = "island_seed" + std::to_string(seed + i) + "_p" +
+                                                   std::to_string(std::lround(variant.persistence * 100.0f)) + "_" +
+                                                   std::to_string(timestamp) + ".png";
+                            std::string fullPath = selectedExportPath + "\\" + filename;
+                            exportQueue.submit(filename, [variant, fullPath, options](ExportQueue::Context& context) mutable {
+                                if (IslandGenerator::render(variant, context)) {
+                                    IslandGenerator::writeSnapshot(variant, fullPath, options, context);
+                                }
+                            });
+                        }
+                    }
+                    statusMessage = "Exporting " + std::to_string(batchSeeds * batchPersistenceSteps) +
+                                    " variants in the background\nLocation: " + selectedExportPath;
+                    statusMessageTimer = 8.0f;
+                }
+            }
+            
+            // Background exports, finished ones stay listed until cleared
+            std::vector<ExportQueue::Status> exports = exportQueue.getStatus();
+            if (!exports.empty()) {
+                const char* stateNames[] = { "Queued", "Running", "Done", "Failed", "Cancelled" };
+                int pending = 0;
+                ImGui::Separator();
+                for (const auto& job : exports) {
+                    bool active = job.state == ExportQueue::State::Queued || job.state == ExportQueue::State::Running;
+                    pending += active ? 1 : 0;
+                    
+                    ImGui::PushID(job.id);
+                    std::string overlay = job.label + " - " + stateNames[static_cast<int>(job.state)];
+                    ImGui::ProgressBar(job.progress, ImVec2(active ? -70.0f * uiScale : -1.0f, 0), overlay.c_str());
+                    if (active) {
+                        ImGui::SameLine();
+                        if (ImGui::Button("Cancel")) {
+                            exportQueue.cancel(job.id);
+                        }
+                    }
+                    if (job.state == ExportQueue::State::Failed) {
+                        ImGui::TextWrapped("%s", job.message.c_str());
+                    }
+                    ImGui::PopID();
+                }
+                if (pending > 1 && ImGui::Button("Cancel All")) {
+                    exportQueue.cancelAll();
+                }
+                if (pending < static_cast<int>(exports.size())) {
+                    if (pending > 1) {
+                        ImGui::SameLine();
+                    }
+                    if (ImGui::Button("Clear Finished")) {
+                        exportQueue.clearFinished();
+                    }
+                }
+            }
         }
         
         // Display status message if any
@@ -460,24 +723,66 @@ int main() {
         ImVec2 contentSize = ImGui::GetContentRegionAvail();
         ImVec2 windowPos = ImGui::GetCursorScreenPos();
         
-        // Calculate scaling to fit the window while maintaining aspect ratio
-        float scaleX = contentSize.x / displaySprite.getTexture()->getSize().x;
-        float scaleY = contentSize.y / displaySprite.getTexture()->getSize().y;
-        float scale = std::min(scaleX, scaleY);
+        // Capture the mouse over the whole map area for zooming and panning
+        ImGui::InvisibleButton("MapCanvas", ImVec2(std::max(contentSize.x, 1.0f), std::max(contentSize.y, 1.0f)));
         
-        // Calculate centered position
-        float spriteWidth = displaySprite.getTexture()->getSize().x * scale;
-        float spriteHeight = displaySprite.getTexture()->getSize().y * scale;
-        float offsetX = (contentSize.x - spriteWidth) * 0.5f;
-        float offsetY = (contentSize.y - spriteHeight) * 0.5f;
+        // At zoom 1 the world fits the window while maintaining aspect ratio
+        double pixelsPerUnit = std::max(1.0f, std::min(contentSize.x, contentSize.y)) * mapZoom;
+        double cursorX = io.MousePos.x - windowPos.x - contentSize.x * 0.5f;
+        double cursorY = io.MousePos.y - windowPos.y - contentSize.y * 0.5f;
         
-        // Draw the texture in the ImGui window
-        ImTextureID texId = (ImTextureID)(intptr_t)displaySprite.getTexture()->getNativeHandle();
-        ImGui::GetWindowDrawList()->AddImage(
-            texId,
-            ImVec2(windowPos.x + offsetX, windowPos.y + offsetY),
-            ImVec2(windowPos.x + offsetX + spriteWidth, windowPos.y + offsetY + spriteHeight)
-        );
+        if (ImGui::IsItemHovered() && io.MouseWheel != 0.0f) {
+            // Zoom around the cursor so the point under it stays in place
+            double worldX = mapCenterX + cursorX / pixelsPerUnit;
+            double worldY = mapCenterY + cursorY / pixelsPerUnit;
+            mapZoom = std::max(1.0f, std::min(maxMapZoom, mapZoom * std::pow(1.25f, io.MouseWheel)));
+            pixelsPerUnit = std::max(1.0f, std::min(contentSize.x, contentSize.y)) * mapZoom;
+            mapCenterX = worldX - cursorX / pixelsPerUnit;
+            mapCenterY = worldY - cursorY / pixelsPerUnit;
+        }
+        if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+            mapCenterX -= io.MouseDelta.x / pixelsPerUnit;
+            mapCenterY -= io.MouseDelta.y / pixelsPerUnit;
+        }
+        mapCenterX = std::max(0.0, std::min(1.0, mapCenterX));
+        mapCenterY = std::max(0.0, std::min(1.0, mapCenterY));
+        
+        // Only the visible part of the world is generated, at screen resolution
+        double halfWidth = contentSize.x * 0.5 / pixelsPerUnit;
+        double halfHeight = contentSize.y * 0.5 / pixelsPerUnit;
+        std::vector<TileCache::DrawItem> tiles;
+        try {
+            tiles = tileCache.update(islandGen, noiseGen, scale, octaves, persistence,
+                                     mapCenterX - halfWidth, mapCenterY - halfHeight,
+                                     mapCenterX + halfWidth, mapCenterY + halfHeight,
+                                     pixelsPerUnit, sf::milliseconds(8));
+        } catch (const std::exception& e) {
+            statusMessage = "Error generating map tiles: " + std::string(e.what());
+            statusMessageTimer = 5.0f;
+        }
+        if (awaitingTiles && tileCache.getPendingTiles() == 0) {
+            recorder->record(recordedParameters, changeClock.getElapsedTime().asMicroseconds() / 1000.0);
+            awaitingTiles = false;
+        }
+        
+        // Draw the tiles in the ImGui window
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        drawList->PushClipRect(windowPos, ImVec2(windowPos.x + contentSize.x, windowPos.y + contentSize.y), true);
+        for (const auto& tile : tiles) {
+            float originX = windowPos.x + contentSize.x * 0.5f;
+            float originY = windowPos.y + contentSize.y * 0.5f;
+            ImTextureID texId = (ImTextureID)(intptr_t)tile.texture->getNativeHandle();
+            drawList->AddImage(
+                texId,
+                ImVec2(originX + static_cast<float>((tile.left - mapCenterX) * pixelsPerUnit),
+                       originY + static_cast<float>((tile.top - mapCenterY) * pixelsPerUnit)),
+                ImVec2(originX + static_cast<float>((tile.right - mapCenterX) * pixelsPerUnit),
+                       originY + static_cast<float>((tile.bottom - mapCenterY) * pixelsPerUnit)),
+                ImVec2(tile.u0, tile.v0),
+                ImVec2(tile.u1, tile.v1)
+            );
+        }
+        drawList->PopClipRect();
         
         ImGui::End();
         ImGui::PopStyleVar();
@@ -491,6 +796,10 @@ int main() {
         window.display();
     }
     
+    if (awaitingTiles) {
+        recorder->record(recordedParameters, changeClock.getElapsedTime().asMicroseconds() / 1000.0, false);
+    }
+    
     ImGui_SFML_Shutdown();
     return 0;
 } 
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "NoiseGenerator.hpp"
+#include "TerrainMesh.hpp"
+#include "TerrainSampler.hpp"
+#include "WorkerPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Generates a heightmap and writes it as an adaptive triangle mesh, binary glTF or
+// OBJ depending on the file extension. Reports the mesh size and where the time went.
+
+namespace {
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options] OUTPUT\n"
+                  << "  --size N           Map size in pixels, rounded up to a power of two (default: 4096)\n"
+                  << "  --seed N           Noise seed (default: 1)\n"
+                  << "  --max-error F      Largest mesh error in world units (default: 0.5)\n"
+                  << "  --max-triangles N  Triangle budget, raises the error bound to fit (default: none)\n"
+                  << "  --cell-size F      World units per grid step (default: 1)\n"
+                  << "  --height-scale F   World units per unit of height (default: 64)\n";
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int size = 4096;
+    int seed = 1;
+    TerrainMesh::Options options;
+    std::string outputFile;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-error") == 0 && i + 1 < argc) {
+            options.maxError = std::strtof(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--max-triangles") == 0 && i + 1 < argc) {
+            options.maxTriangles = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--cell-size") == 0 && i + 1 < argc) {
+            options.cellSize = std::strtof(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--height-scale") == 0 && i + 1 < argc) {
+            options.heightScale = std::strtof(argv[++i], nullptr);
+        } else if (argv[i][0] != '-' && outputFile.empty()) {
+            outputFile = argv[i];
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (size == 0 || outputFile.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    NoiseGenerator noiseGen;
+    noiseGen.setSeed(seed);
+    TerrainSampler terrain;
+    WorkerPool pool;
+
+    // Heights on the grid, in row blocks across the pool
+    auto start = std::chrono::steady_clock::now();
+    const unsigned int gridSize = TerrainMesh::gridSizeFor(size, size);
+    std::vector<float> heights(static_cast<std::size_t>(gridSize) * gridSize);
+    const unsigned int rowsPerBlock = 32;
+    pool.parallelFor(static_cast<int>((gridSize + rowsPerBlock - 1) / rowsPerBlock), [&](int block) {
+        unsigned int top = static_cast<unsigned int>(block) * rowsPerBlock;
+        unsigned int rows = std::min(rowsPerBlock, gridSize - top);
+        terrain.generateHeights(noiseGen, 4.0f, 6, 0.5f, gridSize - 1, gridSize - 1, 0, top, gridSize, rows,
+                                heights.data() + static_cast<std::size_t>(top) * gridSize, gridSize);
+    });
+    double heightMilliseconds = millisecondsSince(start);
+
+    try {
+        start = std::chrono::steady_clock::now();
+        TerrainMesh mesh = TerrainMesh::build(heights.data(), gridSize, options);
+        double buildMilliseconds = millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        mesh.write(outputFile);
+        double writeMilliseconds = millisecondsSince(start);
+
+        const double fullTriangles = 2.0 * (gridSize - 1) * (gridSize - 1);
+        std::cout << gridSize << "x" << gridSize << " grid -> " << mesh.getTriangleCount() << " triangles, "
+                  << mesh.getVertices().size() << " vertices (" << 100.0 * mesh.getTriangleCount() / fullTriangles
+                  << "% of the full grid), max error " << mesh.getMaxError() << "\n"
+                  << "  heights: " << heightMilliseconds << " ms on " << pool.getThreadCount() << " threads\n"
+                  << "  mesh:    " << buildMilliseconds << " ms\n"
+                  << "  write:   " << writeMilliseconds << " ms -> " << outputFile << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
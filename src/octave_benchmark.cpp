@@ -0,0 +1,153 @@
+#include "NoiseGenerator.hpp"
+#include "TerrainSampler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Compares bounded evaluation, which skips the noise outside the island mask and
+// stops adding octaves once the palette index is certain, against evaluating every
+// octave of every pixel. Reports the share of octaves saved and checks that colors,
+// indices, shaded pixels and heights come out the same.
+
+namespace {
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --size N        Map size in pixels (default: 1024)\n"
+                  << "  --seeds N       Number of seeds, starting at 1 (default: 4)\n"
+                  << "  --octaves N     Noise octaves (default: 6)\n"
+                  << "  --persistence F Noise persistence (default: 0.5)\n"
+                  << "  --climate       Classify the lowlands into climate biomes\n";
+    }
+
+    template <typename Run>
+    double timed(const Run& run) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct Totals {
+        double fullSeconds = 0.0;
+        double boundedSeconds = 0.0;
+        bool identical = true;
+
+        void report(const char* name) const {
+            std::cout << "  " << name << fullSeconds * 1000.0 << " ms -> " << boundedSeconds * 1000.0 << " ms, "
+                      << fullSeconds / boundedSeconds << "x, output " << (identical ? "identical" : "DIFFERS") << "\n";
+        }
+    };
+
+    // Runs a generation with and without bounded evaluation and compares the outputs
+    template <typename T, typename Generate>
+    void compare(TerrainSampler& terrain, std::vector<T>& full, std::vector<T>& bounded,
+                 const Generate& generate, Totals& totals) {
+        terrain.setBoundedEvaluation(false);
+        totals.fullSeconds += timed([&] { generate(full); });
+        terrain.setBoundedEvaluation(true);
+        totals.boundedSeconds += timed([&] { generate(bounded); });
+        totals.identical = totals.identical && full == bounded;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int size = 1024;
+    int seeds = 4;
+    int octaves = 6;
+    float persistence = 0.5f;
+    bool climate = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+            seeds = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--octaves") == 0 && i + 1 < argc) {
+            octaves = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--persistence") == 0 && i + 1 < argc) {
+            persistence = std::strtof(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--climate") == 0) {
+            climate = true;
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (size == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const float scale = 4.0f;
+    const std::size_t pixels = static_cast<std::size_t>(size) * size;
+    const TerrainSampler::Lighting lighting = TerrainSampler::Lighting::fromAngles(315.0f, 45.0f, 0.25f);
+
+    NoiseGenerator noiseGen;
+    TerrainSampler terrain;
+    TerrainSampler::ClimateSettings climateSettings;
+    climateSettings.enabled = climate;
+    terrain.setClimate(climateSettings);
+
+    std::vector<std::uint8_t> fullPixels(pixels * 4), boundedPixels(pixels * 4);
+    std::vector<std::uint8_t> fullIndices(pixels), boundedIndices(pixels);
+    std::vector<std::uint8_t> fullNormals(pixels * 4), boundedNormals(pixels * 4);
+    std::vector<float> fullHeights(pixels), boundedHeights(pixels);
+
+    Totals colors, indices, shaded, heights;
+    unsigned long long octavesUsed = 0;
+    unsigned long long maskedPixels = 0;
+
+    for (int seed = 1; seed <= seeds; ++seed) {
+        noiseGen.setSeed(seed);
+
+        compare(terrain, fullPixels, boundedPixels, [&](std::vector<std::uint8_t>& out) {
+            terrain.generateColors(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, out.data(), size * 4);
+        }, colors);
+        compare(terrain, fullIndices, boundedIndices, [&](std::vector<std::uint8_t>& out) {
+            terrain.generateIndices(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, out.data(), size);
+        }, indices);
+        compare(terrain, fullHeights, boundedHeights, [&](std::vector<float>& out) {
+            terrain.generateHeights(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, out.data(), size);
+        }, heights);
+
+        // Shaded pixels and normals only skip the masked out area
+        terrain.setBoundedEvaluation(false);
+        shaded.fullSeconds += timed([&] {
+            terrain.generateShaded(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, lighting,
+                                   fullPixels.data(), size * 4, fullNormals.data(), size * 4);
+        });
+        terrain.setBoundedEvaluation(true);
+        shaded.boundedSeconds += timed([&] {
+            terrain.generateShaded(noiseGen, scale, octaves, persistence, size, size, 0, 0, size, size, lighting,
+                                   boundedPixels.data(), size * 4, boundedNormals.data(), size * 4);
+        });
+        shaded.identical = shaded.identical && fullPixels == boundedPixels && fullNormals == boundedNormals;
+
+        for (unsigned int y = 0; y < size; ++y) {
+            for (unsigned int x = 0; x < size; ++x) {
+                int used = 0;
+                terrain.sampleBoundedPaletteIndex(noiseGen, static_cast<float>(x) / size, static_cast<float>(y) / size,
+                                                  scale, octaves, persistence, &used);
+                octavesUsed += static_cast<unsigned long long>(used);
+                maskedPixels += used == 0 ? 1 : 0;
+            }
+        }
+    }
+
+    const double totalOctaves = static_cast<double>(pixels) * seeds * octaves;
+    const double totalPixels = static_cast<double>(pixels) * seeds;
+    std::cout << seeds << " seeds on a " << size << "x" << size << " map, " << octaves << " octaves, persistence "
+              << persistence << (climate ? ", climate biomes" : "") << "\n"
+              << "  octaves saved:  " << 100.0 * (1.0 - octavesUsed / totalOctaves) << "%, "
+              << 100.0 * maskedPixels / totalPixels << "% of the pixels outside the island mask, "
+              << octavesUsed / totalPixels << " octaves per pixel on average\n";
+    colors.report("colors:         ");
+    indices.report("indices:        ");
+    heights.report("heights:        ");
+    shaded.report("shaded:         ");
+    std::cout.flush();
+
+    return colors.identical && indices.identical && heights.identical && shaded.identical ? 0 : 1;
+}
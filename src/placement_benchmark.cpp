@@ -0,0 +1,114 @@
+#include "FeaturePlacer.hpp"
+#include "NoiseGenerator.hpp"
+#include "TerrainSampler.hpp"
+#include "WorkerPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Generates a classified map, places features on it and reports instances per
+// second for a single thread and for the whole pool. Optionally writes the list.
+
+namespace {
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --size N        Map size in pixels (default: 4096)\n"
+                  << "  --seed N        Noise and placement seed (default: 1)\n"
+                  << "  --threads N     Pool threads, 0 uses every core (default: 0)\n"
+                  << "  --repeat N      Timed runs per configuration (default: 5)\n"
+                  << "  --out FILE      Write the instance list\n";
+    }
+
+    bool sameInstances(const std::vector<FeaturePlacer::Instance>& a, const std::vector<FeaturePlacer::Instance>& b) {
+        return a.size() == b.size()
+            && std::equal(a.begin(), a.end(), b.begin(), [](const FeaturePlacer::Instance& x, const FeaturePlacer::Instance& y) {
+                   return x.x == y.x && x.y == y.y && x.kind == y.kind && x.terrain == y.terrain && x.variant == y.variant;
+               });
+    }
+
+    // Best of several runs, in seconds
+    double timePlacement(const FeaturePlacer& placer, const std::vector<std::uint8_t>& indices, unsigned int size,
+                         int seed, WorkerPool* pool, int repeat, std::vector<FeaturePlacer::Instance>& instances) {
+        double best = 0.0;
+        for (int run = 0; run < repeat; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            instances = placer.place(indices.data(), size, size, size, seed, pool);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = run == 0 ? seconds : std::min(best, seconds);
+        }
+        return best;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int size = 4096;
+    int seed = 1;
+    unsigned int threads = 0;
+    int repeat = 5;
+    std::string outputFile;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (size == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    NoiseGenerator noiseGen;
+    noiseGen.setSeed(seed);
+    TerrainSampler terrain;
+    WorkerPool pool(threads);
+
+    // Classify the map with the application's default parameters
+    std::vector<std::uint8_t> indices(static_cast<std::size_t>(size) * size);
+    const unsigned int rowsPerBlock = 32;
+    pool.parallelFor(static_cast<int>((size + rowsPerBlock - 1) / rowsPerBlock), [&](int block) {
+        unsigned int top = static_cast<unsigned int>(block) * rowsPerBlock;
+        unsigned int rows = std::min(rowsPerBlock, size - top);
+        terrain.generateIndices(noiseGen, 4.0f, 6, 0.5f, size, size, 0, top, size, rows,
+                                indices.data() + static_cast<std::size_t>(top) * size, size);
+    });
+
+    FeaturePlacer placer;
+    std::vector<FeaturePlacer::Instance> serial;
+    std::vector<FeaturePlacer::Instance> parallel;
+    double serialSeconds = timePlacement(placer, indices, size, seed, nullptr, repeat, serial);
+    double parallelSeconds = timePlacement(placer, indices, size, seed, &pool, repeat, parallel);
+
+    std::cout << serial.size() << " instances on a " << size << "x" << size << " map\n"
+              << "  1 thread:   " << serialSeconds * 1000.0 << " ms, "
+              << serial.size() / serialSeconds << " instances/s\n"
+              << "  " << pool.getThreadCount() << " threads:" << (pool.getThreadCount() < 10 ? "  " : " ")
+              << parallelSeconds * 1000.0 << " ms, " << parallel.size() / parallelSeconds << " instances/s\n"
+              << "  parallel result " << (sameInstances(serial, parallel) ? "matches" : "DIFFERS FROM") << " the serial one"
+              << std::endl;
+
+    if (!outputFile.empty()) {
+        try {
+            FeaturePlacer::write(outputFile, parallel, size, size, seed);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    return sameInstances(serial, parallel) ? 0 : 1;
+}
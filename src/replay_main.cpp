@@ -0,0 +1,153 @@
+#include "MapGenerator.hpp"
+#include "NoiseGenerator.hpp"
+#include "SessionTrace.hpp"
+#include "TerrainSampler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless replay of a session recorded by the application with --record. Every
+// regeneration runs the same MapGenerator work as IslandGenerator::generate,
+// without the texture upload, and the latencies are reported as percentiles.
+
+namespace {
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options] TRACE\n"
+                  << "  --fast          Replay as fast as possible instead of at the recorded timing\n"
+                  << "  --repeat N      Replay the trace N times (default: 1)\n"
+                  << "  --max-p95 MS    Exit with an error when the p95 latency is above MS\n";
+    }
+
+    // Same settings as IslandGenerator::generate passes on
+    void regenerate(const SessionTrace::Parameters& parameters, unsigned int width, unsigned int height,
+                    NoiseGenerator& noiseGen, TerrainSampler& terrain, MapGenerator& map) {
+        noiseGen.setSeed(parameters.seed);
+        terrain.setSeaLevel(parameters.seaLevel);
+        terrain.setBeachSize(parameters.beachSize);
+        terrain.setMountainLevel(parameters.mountainLevel);
+        terrain.setSnowLevel(parameters.snowLevel);
+        terrain.setClimate(parameters.climate);
+
+        MapGenerator::Settings settings;
+        settings.indexed = parameters.indexed;
+        settings.shading = parameters.shading;
+        settings.lighting = TerrainSampler::Lighting::fromAngles(
+            parameters.lightAzimuth, parameters.lightElevation, parameters.relief);
+        settings.octaveCache = parameters.octaveCache;
+        map.generate(terrain, noiseGen, parameters.scale, parameters.octaves, parameters.persistence,
+                     width, height, settings);
+    }
+
+    // Nearest-rank percentile of sorted values
+    double percentile(const std::vector<double>& sorted, double p) {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size(), std::max<std::size_t>(rank, 1)) - 1];
+    }
+
+    void printPercentiles(const char* label, std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        std::cout << "  " << label << std::fixed << std::setprecision(2)
+                  << "p50 " << percentile(values, 50.0) << " ms, "
+                  << "p95 " << percentile(values, 95.0) << " ms, "
+                  << "p99 " << percentile(values, 99.0) << " ms, "
+                  << "max " << values.back() << " ms\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool fast = false;
+    int repeat = 1;
+    double maxP95 = -1.0;
+    std::string traceFile;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--fast") == 0) {
+            fast = true;
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-p95") == 0 && i + 1 < argc) {
+            maxP95 = std::strtod(argv[++i], nullptr);
+        } else if (argv[i][0] != '-' && traceFile.empty()) {
+            traceFile = argv[i];
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (traceFile.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    SessionTrace trace;
+    try {
+        trace = SessionTrace::load(traceFile);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (trace.getEvents().empty()) {
+        std::cerr << "Error: " << traceFile << " contains no regenerations" << std::endl;
+        return 1;
+    }
+
+    const unsigned int width = trace.getWidth();
+    const unsigned int height = trace.getHeight();
+    NoiseGenerator noiseGen;
+    TerrainSampler terrain;
+    MapGenerator map;
+    std::vector<double> latencies;
+    std::vector<double> serviceTimes;
+    std::vector<double> recorded;
+
+    typedef std::chrono::steady_clock Clock;
+    for (int run = 0; run < repeat; ++run) {
+        Clock::time_point start = Clock::now();
+        for (const SessionTrace::Event& event : trace.getEvents()) {
+            // At the recorded timing a regeneration that starts late because the previous
+            // one overran counts the wait, as it would for someone dragging a slider
+            Clock::time_point scheduled = start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::milli>(event.time));
+            if (fast) {
+                scheduled = Clock::now();
+            } else {
+                std::this_thread::sleep_until(scheduled);
+            }
+
+            Clock::time_point begin = Clock::now();
+            regenerate(event.parameters, width, height, noiseGen, terrain, map);
+            Clock::time_point end = Clock::now();
+
+            latencies.push_back(std::chrono::duration<double, std::milli>(end - scheduled).count());
+            serviceTimes.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+            if (run == 0 && event.recordedLatency >= 0.0) {
+                recorded.push_back(event.recordedLatency);
+            }
+        }
+    }
+
+    std::cout << "Replayed " << latencies.size() << " regenerations of a " << width << "x" << height << " map "
+              << (fast ? "as fast as possible" : "at the recorded timing") << "\n";
+    printPercentiles("latency:  ", latencies);
+    if (!fast) {
+        printPercentiles("service:  ", serviceTimes);
+    }
+    if (!recorded.empty()) {
+        printPercentiles("recorded: ", recorded);
+    }
+
+    std::vector<double> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    if (maxP95 >= 0.0 && percentile(sorted, 95.0) > maxP95) {
+        std::cerr << "p95 latency " << percentile(sorted, 95.0) << " ms is above the limit of " << maxP95 << " ms" << std::endl;
+        return 1;
+    }
+    return 0;
+}